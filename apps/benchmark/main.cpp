@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <functional>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/utils/logger.hpp>
+
+#include <banana-lib/binary-mask.hpp>
+#include <banana-lib/lib.hpp>
+#include <banana-lib/static-analyzer.hpp>
+
+/// Number of runs per benchmark if nothing else has been specified.
+constexpr std::size_t kDefaultIterations = 20;
+
+/// The command line arguments.
+struct Arguments {
+    std::filesystem::path image_path;
+    std::size_t iterations;
+};
+
+/// Timing of a benchmark (in milliseconds).
+struct Timing {
+    double mean_ms;
+    double min_ms;
+};
+
+[[nodiscard]]
+auto GetArgumentsFromArgs(int const argc, char const * const argv[]) -> Arguments {
+    if(argc < 2 || argc > 3) {
+        throw std::runtime_error(std::format("expected 1 or 2 arguments but got {}!", argc-1));
+    }
+
+    auto const image_path = std::filesystem::path(argv[1]);
+    if (!std::filesystem::exists(image_path)) {
+        throw std::runtime_error(std::format("specified path does not exist: {}", image_path.string()));
+    }
+
+    auto const iterations = argc == 3 ? std::stoul(argv[2]) : kDefaultIterations;
+    if (iterations == 0) {
+        throw std::runtime_error("at least one iteration is needed!");
+    }
+
+    return {
+        .image_path = image_path,
+        .iterations = iterations,
+    };
+}
+
+/**
+ * Run the function repeatedly and measure how long it takes. One additional warm-up run is done first.
+ */
+[[nodiscard]]
+auto Measure(std::size_t const iterations, std::function<void()> const& function) -> Timing {
+    function();
+
+    std::vector<double> durations_ms;
+    for (std::size_t i = 0; i < iterations; ++i) {
+        auto const start = std::chrono::steady_clock::now();
+        function();
+        durations_ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    return {
+        .mean_ms = std::accumulate(durations_ms.cbegin(), durations_ms.cend(), 0.0) / static_cast<double>(durations_ms.size()),
+        .min_ms = std::ranges::min(durations_ms),
+    };
+}
+
+void PrintComparison(std::string const& name, Timing const& baseline, Timing const& candidate) {
+    std::cout << std::format("{:<45} {:>10.2f} ms {:>10.2f} ms {:>10.2f} ms {:>10.2f} ms {:>8.2f}x",
+                             name, baseline.mean_ms, baseline.min_ms, candidate.mean_ms, candidate.min_ms,
+                             baseline.mean_ms / candidate.mean_ms) << std::endl;
+}
+
+int main(int const argc, char const * const argv[]) {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_WARNING);
+
+    try {
+        auto const arguments = GetArgumentsFromArgs(argc, argv);
+        auto const image = cv::imread(arguments.image_path.string());
+        if (image.empty()) {
+            throw std::runtime_error(std::format("unable to read image: {}", arguments.image_path.string()));
+        }
+
+        std::cout << std::format("image: {} ({}x{}), {} iterations", arguments.image_path.string(), image.cols, image.rows, arguments.iterations) << std::endl;
+        std::cout << std::format("{:<45} {:>13} {:>13} {:>13} {:>13} {:>9}", "", "baseline mean", "baseline min", "mean", "min", "speedup") << std::endl;
+
+        {
+            banana::Analyzer const analyzer{{
+                .pixels_per_meter = 1,
+            }};
+            banana::StaticAnalyzer<banana::StaticSettings{.pixels_per_meter = 1}> const static_analyzer;
+
+            auto const baseline = Measure(arguments.iterations, [&] { auto const _ = analyzer.AnalyzeImage(image); });
+            auto const candidate = Measure(arguments.iterations, [&] { auto const _ = static_analyzer.AnalyzeImage(image); });
+            PrintComparison("Analyzer vs. StaticAnalyzer", baseline, candidate);
+        }
+
+        // the detection mask is benchmarked on the image scaled to common video resolutions
+        for (auto const& [resolution_name, resolution] : {std::pair{"1080p", cv::Size{1920, 1080}}, std::pair{"4K", cv::Size{3840, 2160}}}) {
+            cv::Mat scaled_image;
+            cv::resize(image, scaled_image, resolution);
+
+            banana::Analyzer::Settings const settings{
+                .pixels_per_meter = 1,
+            };
+            cv::Mat hsv_image, filtered_image;
+            cv::cvtColor(scaled_image, hsv_image, cv::COLOR_BGR2HSV);
+            cv::inRange(hsv_image, settings.filter_lower_threshold_color, settings.filter_upper_threshold_color, filtered_image);
+
+            auto const kernel = cv::getStructuringElement(cv::MORPH_RECT, {5, 5});
+            auto const baseline = Measure(arguments.iterations, [&] {
+                cv::Mat mask;
+                cv::morphologyEx(filtered_image, mask, cv::MORPH_OPEN, kernel);
+                cv::medianBlur(mask, mask, 37);
+            });
+            auto const candidate = Measure(arguments.iterations, [&] {
+                auto const _ = banana::BinaryMask::FromMat(filtered_image).Open(5).MajorityFilter(37).ToMat();
+            });
+            PrintComparison(std::format("detection mask {}: OpenCV vs. bit-packed", resolution_name), baseline, candidate);
+
+            banana::Analyzer const analyzer{{
+                .pixels_per_meter = 1,
+            }};
+            banana::Analyzer const bit_packed_analyzer{{
+                .pixels_per_meter = 1,
+                .bit_packed_detection_mask = true,
+            }};
+            auto const analyzer_baseline = Measure(arguments.iterations, [&] { auto const _ = analyzer.AnalyzeImage(scaled_image); });
+            auto const analyzer_candidate = Measure(arguments.iterations, [&] { auto const _ = bit_packed_analyzer.AnalyzeImage(scaled_image); });
+            PrintComparison(std::format("Analyzer {}: OpenCV vs. bit-packed mask", resolution_name), analyzer_baseline, analyzer_candidate);
+        }
+    } catch (std::exception const& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " image_path [iterations]" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
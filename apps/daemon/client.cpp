@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <format>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/utils/logger.hpp>
+
+#include "shared-ring.hpp"
+
+/**
+ * Print the results of the frames which have been analysed, in the order in which they were published, and give their
+ * slots back.
+ */
+void CollectResults(bananad::SharedRing const& ring, std::deque<std::pair<std::uint32_t, std::uint64_t>>& pending) {
+    while (!pending.empty() && ring.IsDone(pending.front().first)) {
+        auto const [slot, frame_number] = pending.front();
+        pending.pop_front();
+
+        auto const& header = ring.GetSlot(slot);
+        auto const latency_ms = static_cast<double>(header.finished_at_ns - header.published_at_ns) / 1e6;
+        if (header.status != BANANA_STATUS_OK && header.status != BANANA_STATUS_BUFFER_TOO_SMALL) {
+            std::cerr << std::format("frame {}: analysis failed with status {}", frame_number, static_cast<int>(header.status)) << std::endl;
+        } else {
+            std::cout << std::format("frame {}: {} banana(s) after {:.1f} ms", frame_number, header.num_results, latency_ms) << std::endl;
+            for (std::size_t i = 0; i < std::min<std::size_t>(header.num_results, bananad::kMaxResultsPerSlot); ++i) {
+                auto const& result = header.results[i];
+                std::cout << std::format("  at ({}, {}): length {:.3f} m, curvature {:.3f} 1/m, ripeness {:.1f} % (+/- {:.1f} %)",
+                                         result.estimated_center.x, result.estimated_center.y, result.length, result.mean_curvature,
+                                         result.ripeness * 100, result.ripeness_uncertainty * 100);
+                if (result.zone_id != -1) {
+                    std::cout << std::format(" in zone {}", result.zone_id);
+                }
+                std::cout << std::endl;
+            }
+        }
+        ring.Release(slot);
+    }
+}
+
+int main(int const argc, char const * const argv[]) {
+    cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_WARNING);
+
+    try {
+        if (argc < 2 || argc > 3) {
+            throw std::runtime_error("invalid arguments!");
+        }
+        std::string const source{argv[1]};
+        std::string const shm_name = argc == 3 ? argv[2] : "/banana-frames";
+
+        auto const ring = bananad::SharedRing::Open(shm_name);
+        auto const frame_capacity = ring.GetHeader().frame_capacity;
+
+        cv::VideoCapture capture;
+        try {
+            // numeric value => it's the index of a video device
+            capture.open(std::stoi(source));
+        } catch (std::invalid_argument const& ex) {
+            capture.open(source);
+        }
+        if (!capture.isOpened()) {
+            throw std::runtime_error(std::format("can't open video source {}", source));
+        }
+        // live sources (cameras, streams) don't know how many frames they have
+        auto const is_recording = capture.get(cv::CAP_PROP_FRAME_COUNT) > 0;
+
+        std::deque<std::pair<std::uint32_t, std::uint64_t>> pending;
+        std::uint64_t frame_number = 0;
+        std::uint64_t dropped_frames = 0;
+        cv::Mat discarded_frame;
+        while (true) {
+            CollectResults(ring, pending);
+
+            auto const slot = ring.TryAcquireSlot();
+            if (!slot) {
+                if (is_recording) {
+                    // recordings don't lose frames, wait for the daemon instead
+                    std::this_thread::sleep_for(std::chrono::milliseconds{1});
+                    continue;
+                }
+                // live sources keep going, the frame which doesn't fit into the ring buffer is lost
+                if (!capture.read(discarded_frame)) {
+                    break;
+                }
+                ++frame_number;
+                ++dropped_frames;
+                continue;
+            }
+
+            // decode directly into the shared memory once the size of the frames is known, thus the frame is never copied
+            cv::Mat frame;
+            auto const width = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_WIDTH));
+            auto const height = static_cast<int>(capture.get(cv::CAP_PROP_FRAME_HEIGHT));
+            auto* const frame_data = ring.GetFrameData(*slot);
+            if (width > 0 && height > 0 && static_cast<std::uint64_t>(width) * height * 3 <= frame_capacity) {
+                frame = cv::Mat{height, width, CV_8UC3, frame_data};
+            }
+            if (!capture.read(frame)) {
+                // the slot is still owned by us, thus it can be given back directly
+                ring.Release(*slot);
+                break;
+            }
+            if (frame.type() != CV_8UC3 || frame.total() * frame.elemSize() > frame_capacity) {
+                ring.Release(*slot);
+                throw std::runtime_error(std::format("frame {} doesn't fit into the shared memory ({} bytes per slot)", frame_number, frame_capacity));
+            }
+            if (frame.data != frame_data) {
+                // the backend allocated its own buffer (e.g. the size changed), fall back to copying
+                frame.copyTo(cv::Mat{frame.rows, frame.cols, CV_8UC3, frame_data});
+            }
+
+            ring.Publish(*slot, frame.cols, frame.rows, frame.cols * frame.elemSize(), BANANA_PIXEL_FORMAT_BGR8);
+            pending.emplace_back(*slot, frame_number);
+            ++frame_number;
+        }
+
+        // wait for the frames which are still being analysed
+        while (!pending.empty()) {
+            CollectResults(ring, pending);
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        std::cout << std::format("{} frames read, {} dropped because the daemon was busy", frame_number, dropped_frames) << std::endl;
+    } catch (std::exception const& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << "Usage: " << argv[0] << " capture_device_id|video_path [shm_name]" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <banana-lib/banana.h>
+
+#include "shared-ring.hpp"
+
+/// Longest time an idle worker sleeps before looking for a new frame again.
+constexpr std::chrono::microseconds kMaxIdleSleep{1000};
+
+/// How often the slots of producers which died are looked for.
+constexpr std::chrono::seconds kReclaimInterval{1};
+
+/// Set by the signal handler to shut down.
+volatile std::sig_atomic_t stop_requested = 0;
+
+/// An inspection zone given on the command line as `ID:X1,Y1,X2,Y2,X3,Y3[,...]`.
+struct ZoneArgument {
+    std::int32_t id;
+    std::vector<banana_point_t> points;
+};
+
+/// The command line arguments.
+struct Arguments {
+    std::string shm_name;
+    std::uint32_t num_slots;
+    std::uint64_t frame_capacity;
+    std::size_t num_workers;
+    double pixels_per_meter;
+    std::chrono::seconds stats_interval;
+    std::vector<ZoneArgument> zones;
+};
+
+/// Counters of the workers of this daemon, in addition to the ones in the shared memory.
+struct WorkerStats {
+    std::atomic<std::uint64_t> latency_sum_ns{0};
+    std::atomic<std::uint64_t> max_latency_ns{0};
+};
+
+[[nodiscard]]
+auto ParseZone(std::string const& value) -> ZoneArgument {
+    auto const separator = value.find(':');
+    if (separator == std::string::npos) {
+        throw std::runtime_error(std::format("expected ID:X1,Y1,X2,Y2,... for --zone but got {}", value));
+    }
+    auto const coordinate_list = value.substr(separator + 1);
+    auto const coordinates = coordinate_list
+                             | std::views::split(',')
+                             | std::views::transform([](auto const& part) { return std::stoi(std::string{part.begin(), part.end()}); })
+                             | std::ranges::to<std::vector>();
+    if (coordinates.size() < 6 || coordinates.size() % 2 != 0) {
+        throw std::runtime_error(std::format("the zone {} needs at least three points with two coordinates each", value));
+    }
+
+    ZoneArgument zone{.id = std::stoi(value.substr(0, separator)), .points = {}};
+    for (std::size_t i = 0; i < coordinates.size(); i += 2) {
+        zone.points.push_back({coordinates[i], coordinates[i + 1]});
+    }
+    return zone;
+}
+
+[[nodiscard]]
+auto GetArgumentsFromArgs(int const argc, char const * const argv[]) -> Arguments {
+    Arguments arguments{
+        .shm_name = "/banana-frames",
+        .num_slots = 16,
+        .frame_capacity = 3840 * 2160 * 4,
+        .num_workers = std::max(1u, std::thread::hardware_concurrency()),
+        .pixels_per_meter = 0,
+        .stats_interval = std::chrono::seconds{5},
+        .zones = {},
+    };
+
+    auto const get_value = [&](int& i) -> std::string {
+        if (i + 1 >= argc) {
+            throw std::runtime_error(std::format("missing value for {}!", argv[i]));
+        }
+        return argv[++i];
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg{argv[i]};
+        if (arg == "--name") {
+            arguments.shm_name = get_value(i);
+        } else if (arg == "--slots") {
+            arguments.num_slots = static_cast<std::uint32_t>(std::stoul(get_value(i)));
+        } else if (arg == "--frame-capacity") {
+            arguments.frame_capacity = std::stoull(get_value(i));
+        } else if (arg == "--workers") {
+            arguments.num_workers = std::stoul(get_value(i));
+        } else if (arg == "--pixels-per-meter") {
+            arguments.pixels_per_meter = std::stod(get_value(i));
+        } else if (arg == "--stats-interval") {
+            arguments.stats_interval = std::chrono::seconds{std::stol(get_value(i))};
+        } else if (arg == "--zone") {
+            arguments.zones.push_back(ParseZone(get_value(i)));
+        } else {
+            throw std::runtime_error(std::format("unknown argument: {}", arg));
+        }
+    }
+
+    if (arguments.num_workers == 0) {
+        throw std::runtime_error("at least one worker is needed!");
+    }
+    if (arguments.pixels_per_meter <= 0) {
+        throw std::runtime_error("--pixels-per-meter must be set to a positive value!");
+    }
+    if (arguments.stats_interval.count() <= 0) {
+        throw std::runtime_error("--stats-interval must be positive!");
+    }
+
+    return arguments;
+}
+
+/**
+ * Analyse the frames in the ring buffer until stop is requested. The frames are analysed in place and the results are
+ * written directly into the slot.
+ */
+void AnalyzeFrames(std::stop_token const& stop_token, bananad::SharedRing const& ring, banana_analyzer_t const* const analyzer, WorkerStats& stats) {
+    auto idle_sleep = std::chrono::microseconds{1};
+    while (!stop_token.stop_requested()) {
+        auto const slot = ring.TryClaimOldestReady();
+        if (!slot) {
+            // back off exponentially to not burn a core while there are no frames, but react quickly while there are
+            std::this_thread::sleep_for(idle_sleep);
+            idle_sleep = std::min(idle_sleep * 2, kMaxIdleSleep);
+            continue;
+        }
+        idle_sleep = std::chrono::microseconds{1};
+
+        auto& header = ring.GetSlot(*slot);
+        // divide instead of multiplying, a bogus stride could otherwise overflow and pass the check
+        auto const rows = static_cast<std::uint64_t>(std::max(header.height, 1));
+        if (header.stride > ring.GetHeader().frame_capacity / rows) {
+            header.status = BANANA_STATUS_INVALID_ARGUMENT;
+            header.num_results = 0;
+        } else {
+            banana_image_t const image{ring.GetFrameData(*slot), header.width, header.height, header.stride, header.format};
+            banana_output_t output{header.results, bananad::kMaxResultsPerSlot, 0, nullptr, 0, 0};
+            header.status = banana_analyze(analyzer, &image, &output);
+            header.num_results = output.num_results;
+        }
+
+        auto& ring_header = ring.GetHeader();
+        ring_header.processed_frames.fetch_add(1, std::memory_order_relaxed);
+        if (header.status != BANANA_STATUS_OK && header.status != BANANA_STATUS_BUFFER_TOO_SMALL) {
+            ring_header.failed_frames.fetch_add(1, std::memory_order_relaxed);
+        }
+        // the slot belongs to the producer again once it is completed, thus nothing may be read from it afterwards
+        auto const published_at_ns = header.published_at_ns;
+        ring.Complete(*slot);
+
+        auto const latency_ns = static_cast<std::uint64_t>(std::max<std::int64_t>(bananad::GetTimestampNs() - published_at_ns, 0));
+        stats.latency_sum_ns.fetch_add(latency_ns, std::memory_order_relaxed);
+        auto max_latency_ns = stats.max_latency_ns.load(std::memory_order_relaxed);
+        while (latency_ns > max_latency_ns && !stats.max_latency_ns.compare_exchange_weak(max_latency_ns, latency_ns, std::memory_order_relaxed)) {
+        }
+    }
+}
+
+/// Print the throughput and the occupancy of the ring buffer since the last report.
+void PrintStats(bananad::SharedRing const& ring, WorkerStats& stats, std::uint64_t& last_processed_frames, std::chrono::duration<double> const interval) {
+    auto const& header = ring.GetHeader();
+    auto const processed_frames = header.processed_frames.load(std::memory_order_relaxed);
+    auto const new_frames = processed_frames - last_processed_frames;
+    last_processed_frames = processed_frames;
+
+    auto const latency_sum_ns = stats.latency_sum_ns.exchange(0, std::memory_order_relaxed);
+    auto const max_latency_ns = stats.max_latency_ns.exchange(0, std::memory_order_relaxed);
+    auto const mean_latency_ms = new_frames > 0 ? static_cast<double>(latency_sum_ns) / static_cast<double>(new_frames) / 1e6 : 0.0;
+
+    std::cout << std::format("{:.1f} frames/s, latency {:.1f} ms (max {:.1f} ms), slots: {} waiting, {} processing, {} done, {} free of {}, {} processed ({} failed)",
+                             static_cast<double>(new_frames) / interval.count(), mean_latency_ms, static_cast<double>(max_latency_ns) / 1e6,
+                             ring.CountSlots(bananad::SlotState::kReady), ring.CountSlots(bananad::SlotState::kProcessing),
+                             ring.CountSlots(bananad::SlotState::kDone), ring.CountSlots(bananad::SlotState::kFree), header.num_slots,
+                             processed_frames, header.failed_frames.load(std::memory_order_relaxed)) << std::endl;
+}
+
+int main(int const argc, char const * const argv[]) {
+    try {
+        auto const arguments = GetArgumentsFromArgs(argc, argv);
+
+        banana_settings_t settings;
+        banana_settings_init(&settings);
+        settings.pixels_per_meter = arguments.pixels_per_meter;
+        auto const zones = arguments.zones
+                           | std::views::transform([](ZoneArgument const& zone) {
+                               return banana_inspection_zone_t{zone.id, zone.points.data(), zone.points.size()};
+                           })
+                           | std::ranges::to<std::vector>();
+        settings.inspection_zones = zones.data();
+        settings.num_inspection_zones = zones.size();
+        banana_analyzer_t* raw_analyzer = nullptr;
+        if (banana_analyzer_create(&settings, &raw_analyzer) != BANANA_STATUS_OK) {
+            throw std::runtime_error(std::format("can't create the analyzer: {}", banana_get_last_error_message()));
+        }
+        std::unique_ptr<banana_analyzer_t, decltype(&banana_analyzer_destroy)> const analyzer{raw_analyzer, banana_analyzer_destroy};
+
+        {
+            auto const ring = bananad::SharedRing::Create(arguments.shm_name, arguments.num_slots, arguments.frame_capacity);
+
+            std::signal(SIGINT, [](int) { stop_requested = 1; });
+            std::signal(SIGTERM, [](int) { stop_requested = 1; });
+
+            // the analyzer is thread-safe, thus all workers share it
+            WorkerStats stats;
+            std::vector<std::jthread> workers;
+            for (std::size_t i = 0; i < arguments.num_workers; ++i) {
+                workers.emplace_back(AnalyzeFrames, std::cref(ring), analyzer.get(), std::ref(stats));
+            }
+
+            std::cout << std::format("Analysing frames from shared memory {} ({} slots of {} bytes) with {} worker(s). Press Ctrl+C to quit.",
+                                     arguments.shm_name, arguments.num_slots, arguments.frame_capacity, arguments.num_workers) << std::endl;
+
+            std::uint64_t last_processed_frames = 0;
+            auto last_report = std::chrono::steady_clock::now();
+            auto last_reclaim = last_report;
+            while (stop_requested == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds{100});
+                auto const now = std::chrono::steady_clock::now();
+                if (now - last_reclaim >= kReclaimInterval) {
+                    if (auto const reclaimed_slots = ring.ReclaimAbandonedSlots(); reclaimed_slots > 0) {
+                        std::cout << std::format("freed {} slot(s) of producers which exited without releasing them", reclaimed_slots) << std::endl;
+                    }
+                    last_reclaim = now;
+                }
+                if (now - last_report >= arguments.stats_interval) {
+                    PrintStats(ring, stats, last_processed_frames, now - last_report);
+                    last_report = now;
+                }
+            }
+
+            std::cout << "shutting down" << std::endl;
+            // the workers must be stopped before the ring buffer is unmapped
+            workers.clear();
+        }
+    } catch (std::exception const& ex) {
+        std::cerr << ex.what() << std::endl;
+        std::cerr << "Usage: " << argv[0]
+                  << " --pixels-per-meter VALUE [--name SHM_NAME] [--slots N] [--frame-capacity BYTES] [--workers N] [--stats-interval SECONDS] [--zone ID:X1,Y1,X2,Y2,X3,Y3[,...] ...]"
+                  << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
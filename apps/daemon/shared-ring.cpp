@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
+#include <format>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "shared-ring.hpp"
+
+namespace bananad {
+
+    namespace {
+        /// Value of `SlotHeader::owner_pid` while the daemon is reclaiming the slot.
+        constexpr std::int32_t kReclaimingPid = -1;
+
+        /// Whether the process still exists (as far as it can be told, process IDs are reused eventually).
+        auto IsProcessRunning(std::int32_t const pid) -> bool {
+            // EPERM: the process exists but belongs to another user
+            return kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM;
+        }
+
+        /// Round up to the next multiple of the cache line size.
+        constexpr auto AlignToCacheLine(std::uint64_t const size) -> std::uint64_t {
+            return (size + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+        }
+
+        auto GetFrameDataOffset(std::uint32_t const num_slots) -> std::size_t {
+            return AlignToCacheLine(sizeof(RingHeader) + num_slots * sizeof(SlotHeader));
+        }
+
+        [[noreturn]]
+        void ThrowSystemError(std::string const& what) {
+            throw std::system_error(errno, std::generic_category(), what);
+        }
+
+        /// Path of the lock file held by the daemon which created the shared memory object with the given name.
+        auto GetLockFilePath(std::string const& name) -> std::filesystem::path {
+            auto file_name = name;
+            std::ranges::replace(file_name, '/', '_');
+            return std::filesystem::temp_directory_path() / std::format("banana-daemon{}.lock", file_name);
+        }
+
+        /**
+         * Take the lock file for the shared memory object, which is held until the returned file descriptor is closed
+         * (i.e. at the latest when the process exits, however it exits).
+         *
+         * @throws std::runtime_error if another process holds the lock.
+         */
+        auto LockSharedMemory(std::string const& name) -> int {
+            auto const lock_path = GetLockFilePath(name);
+            auto const fd = open(lock_path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+            if (fd < 0) {
+                ThrowSystemError(std::format("can't open lock file {}", lock_path.string()));
+            }
+            if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+                auto const error = errno;
+                close(fd);
+                if (error == EWOULDBLOCK) {
+                    throw std::runtime_error(std::format("a daemon is already running for shared memory {} (lock file {})", name, lock_path.string()));
+                }
+                errno = error;
+                ThrowSystemError(std::format("can't lock {}", lock_path.string()));
+            }
+            return fd;
+        }
+
+        /// Map the whole shared memory object into the address space of this process.
+        auto Map(int const fd, std::size_t const size, std::string const& name) -> void* {
+            auto* const memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (memory == MAP_FAILED) {
+                ThrowSystemError(std::format("can't map shared memory {}", name));
+            }
+            return memory;
+        }
+    }
+
+    auto GetSharedMemorySize(std::uint32_t const num_slots, std::uint64_t const frame_capacity) -> std::size_t {
+        return GetFrameDataOffset(num_slots) + num_slots * AlignToCacheLine(frame_capacity);
+    }
+
+    auto GetTimestampNs() -> std::int64_t {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    auto SharedRing::Create(std::string const& name, std::uint32_t const num_slots, std::uint64_t const frame_capacity) -> SharedRing {
+        if (num_slots == 0 || frame_capacity == 0) {
+            throw std::invalid_argument("the ring buffer needs at least one slot with a non-zero capacity");
+        }
+
+        auto const lock_fd = LockSharedMemory(name);
+        auto const size = GetSharedMemorySize(num_slots, frame_capacity);
+        void* memory;
+        try {
+            // the owner of an existing object can't be running anymore as it would hold the lock, thus it has been left
+            // behind by a daemon which didn't shut down cleanly
+            shm_unlink(name.c_str());
+            auto const fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0) {
+                ThrowSystemError(std::format("can't create shared memory {}", name));
+            }
+            if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+                close(fd);
+                shm_unlink(name.c_str());
+                ThrowSystemError(std::format("can't resize shared memory {}", name));
+            }
+            try {
+                memory = Map(fd, size, name);
+            } catch (...) {
+                close(fd);
+                shm_unlink(name.c_str());
+                throw;
+            }
+            close(fd);
+        } catch (...) {
+            close(lock_fd);
+            throw;
+        }
+
+        // the memory is zero-initialised by ftruncate, the objects still need to be created in it
+        auto* const header = new (memory) RingHeader{
+            .magic = 0, // only set once everything has been initialised
+            .layout_version = kLayoutVersion,
+            .num_slots = num_slots,
+            .frame_capacity = frame_capacity,
+            .next_sequence = 0,
+            .processed_frames = 0,
+            .failed_frames = 0,
+        };
+        auto* const slots = reinterpret_cast<std::byte*>(memory) + sizeof(RingHeader);
+        for (std::uint32_t i = 0; i < num_slots; ++i) {
+            new (slots + i * sizeof(SlotHeader)) SlotHeader{}; // kFree
+        }
+        std::atomic_ref{header->magic}.store(kMagic, std::memory_order_release);
+
+        return {name, memory, size, lock_fd};
+    }
+
+    auto SharedRing::Open(std::string const& name) -> SharedRing {
+        auto const fd = shm_open(name.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            ThrowSystemError(std::format("can't open shared memory {} (is the daemon running?)", name));
+        }
+
+        // the daemon creates the object before resizing it, accessing a mapping beyond its end would raise SIGBUS
+        auto const get_object_size = [fd, &name]() -> std::size_t {
+            struct stat status{};
+            if (fstat(fd, &status) != 0) {
+                auto const error = errno;
+                close(fd);
+                errno = error;
+                ThrowSystemError(std::format("can't query the size of shared memory {}", name));
+            }
+            return static_cast<std::size_t>(status.st_size);
+        };
+        auto const throw_incompatible = [fd, &name] {
+            close(fd);
+            throw std::runtime_error(std::format("shared memory {} has not been created by a compatible daemon (or is still being created)", name));
+        };
+        if (get_object_size() < sizeof(RingHeader)) {
+            throw_incompatible();
+        }
+
+        // map the header first to find out how large the whole ring buffer is
+        RingHeader const* header;
+        try {
+            header = static_cast<RingHeader const*>(Map(fd, sizeof(RingHeader), name));
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        auto const is_compatible = std::atomic_ref{const_cast<RingHeader*>(header)->magic}.load(std::memory_order_acquire) == kMagic
+                                   && header->layout_version == kLayoutVersion;
+        auto const size = GetSharedMemorySize(header->num_slots, header->frame_capacity);
+        munmap(const_cast<RingHeader*>(header), sizeof(RingHeader));
+        if (!is_compatible || get_object_size() < size) {
+            throw_incompatible();
+        }
+
+        void* memory;
+        try {
+            memory = Map(fd, size, name);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+        return {name, memory, size, -1};
+    }
+
+    SharedRing::SharedRing(std::string name, void* const memory, std::size_t const size, int const lock_fd)
+            : name_(std::move(name)), memory_(memory), size_(size), lock_fd_(lock_fd) {
+    }
+
+    SharedRing::SharedRing(SharedRing&& other) noexcept
+            : name_(std::move(other.name_)), memory_(std::exchange(other.memory_, nullptr)), size_(other.size_), lock_fd_(std::exchange(other.lock_fd_, -1)) {
+    }
+
+    SharedRing::~SharedRing() {
+        if (memory_ != nullptr) {
+            munmap(memory_, size_);
+        }
+        if (lock_fd_ >= 0) {
+            // only give up the lock once the object is gone, a new daemon would otherwise remove the wrong one
+            shm_unlink(name_.c_str());
+            close(lock_fd_);
+        }
+    }
+
+    auto SharedRing::GetHeader() const -> RingHeader& {
+        return *static_cast<RingHeader*>(memory_);
+    }
+
+    auto SharedRing::GetSlot(std::uint32_t const slot) const -> SlotHeader& {
+        return *reinterpret_cast<SlotHeader*>(static_cast<std::byte*>(memory_) + sizeof(RingHeader) + slot * sizeof(SlotHeader));
+    }
+
+    auto SharedRing::GetFrameData(std::uint32_t const slot) const -> std::uint8_t* {
+        auto const& header = this->GetHeader();
+        return static_cast<std::uint8_t*>(memory_) + GetFrameDataOffset(header.num_slots) + slot * AlignToCacheLine(header.frame_capacity);
+    }
+
+    auto SharedRing::TryAcquireSlot() const -> std::optional<std::uint32_t> {
+        auto const num_slots = this->GetHeader().num_slots;
+        // start where the next frame would go in a FIFO to spread the slots evenly
+        auto const start = static_cast<std::uint32_t>(this->GetHeader().next_sequence.load(std::memory_order_relaxed) % num_slots);
+        auto const pid = static_cast<std::int32_t>(getpid());
+        for (std::uint32_t i = 0; i < num_slots; ++i) {
+            auto const slot = (start + i) % num_slots;
+            auto& header = this->GetSlot(slot);
+            // the owner is set in the same step as the slot is taken, thus the daemon can always tell who owns it
+            std::int32_t expected = 0;
+            if (header.owner_pid.compare_exchange_strong(expected, pid, std::memory_order_acquire)) {
+                header.state.store(SlotState::kWriting, std::memory_order_relaxed);
+                return slot;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void SharedRing::Publish(std::uint32_t const slot, std::int32_t const width, std::int32_t const height,
+                             std::uint64_t const stride, banana_pixel_format_t const format) const {
+        auto& header = this->GetSlot(slot);
+        header.sequence.store(this->GetHeader().next_sequence.fetch_add(1, std::memory_order_relaxed), std::memory_order_relaxed);
+        header.width = width;
+        header.height = height;
+        header.stride = stride;
+        header.format = format;
+        header.published_at_ns = GetTimestampNs();
+        // release: the frame data and the description are visible to the worker which sees the new state
+        header.state.store(SlotState::kReady, std::memory_order_release);
+    }
+
+    auto SharedRing::IsDone(std::uint32_t const slot) const -> bool {
+        return this->GetSlot(slot).state.load(std::memory_order_acquire) == SlotState::kDone;
+    }
+
+    void SharedRing::Release(std::uint32_t const slot) const {
+        auto& header = this->GetSlot(slot);
+        header.state.store(SlotState::kFree, std::memory_order_relaxed);
+        // release: the next producer acquiring the slot only writes to it after the results have been read
+        header.owner_pid.store(0, std::memory_order_release);
+    }
+
+    auto SharedRing::TryClaimOldestReady() const -> std::optional<std::uint32_t> {
+        auto const num_slots = this->GetHeader().num_slots;
+        while (true) {
+            std::optional<std::uint32_t> oldest;
+            auto oldest_sequence = std::numeric_limits<std::uint64_t>::max();
+            for (std::uint32_t slot = 0; slot < num_slots; ++slot) {
+                auto const& header = this->GetSlot(slot);
+                // if the slot changes in the meantime the CAS below fails, thus a stale sequence doesn't matter
+                if (header.state.load(std::memory_order_acquire) != SlotState::kReady) {
+                    continue;
+                }
+                auto const sequence = header.sequence.load(std::memory_order_relaxed);
+                if (sequence < oldest_sequence) {
+                    oldest = slot;
+                    oldest_sequence = sequence;
+                }
+            }
+            if (!oldest) {
+                return std::nullopt;
+            }
+
+            auto expected = SlotState::kReady;
+            if (this->GetSlot(*oldest).state.compare_exchange_strong(expected, SlotState::kProcessing, std::memory_order_acquire)) {
+                return oldest;
+            }
+            // another worker was faster, look again
+        }
+    }
+
+    void SharedRing::Complete(std::uint32_t const slot) const {
+        auto& header = this->GetSlot(slot);
+        header.finished_at_ns = GetTimestampNs();
+        header.state.store(SlotState::kDone, std::memory_order_release);
+    }
+
+    auto SharedRing::ReclaimAbandonedSlots() const -> std::uint32_t {
+        std::uint32_t reclaimed_slots = 0;
+        for (std::uint32_t slot = 0; slot < this->GetHeader().num_slots; ++slot) {
+            auto& header = this->GetSlot(slot);
+            auto owner_pid = header.owner_pid.load(std::memory_order_acquire);
+            if (owner_pid <= 0 || IsProcessRunning(owner_pid)) {
+                continue;
+            }
+            // the owner can't touch the slot anymore, but it may have released it (and another producer acquired it) in
+            // the meantime. once this succeeds nobody but the workers can change the slot.
+            if (!header.owner_pid.compare_exchange_strong(owner_pid, kReclaimingPid, std::memory_order_acquire)) {
+                continue;
+            }
+            auto const state = header.state.load(std::memory_order_acquire);
+            if (state == SlotState::kReady || state == SlotState::kProcessing) {
+                // the frame is analysed anyway, the slot is reclaimed once it's done
+                header.owner_pid.store(owner_pid, std::memory_order_relaxed);
+                continue;
+            }
+            header.state.store(SlotState::kFree, std::memory_order_relaxed);
+            header.owner_pid.store(0, std::memory_order_release);
+            ++reclaimed_slots;
+        }
+        return reclaimed_slots;
+    }
+
+    auto SharedRing::CountSlots(SlotState const state) const -> std::uint32_t {
+        std::uint32_t count = 0;
+        for (std::uint32_t slot = 0; slot < this->GetHeader().num_slots; ++slot) {
+            if (this->GetSlot(slot).state.load(std::memory_order_relaxed) == state) {
+                ++count;
+            }
+        }
+        return count;
+    }
+
+}
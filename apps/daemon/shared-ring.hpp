@@ -0,0 +1,189 @@
+#ifndef BANANA_PROJECT_SHARED_RING_HPP
+#define BANANA_PROJECT_SHARED_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+#include <banana-lib/banana.h>
+
+/// Shared-memory ring buffer through which producer processes pass frames to the analysis daemon and get the results back.
+namespace bananad {
+
+    /// Identifies a shared memory object created by the daemon ("BNNA").
+    constexpr std::uint32_t kMagic = 0x414E4E42;
+    /// Incremented whenever the layout of the shared memory changes.
+    constexpr std::uint32_t kLayoutVersion = 3;
+    /// Maximum number of results stored per frame. `SlotHeader::num_results` tells if there were more bananas.
+    constexpr std::size_t kMaxResultsPerSlot = 16;
+    /// Everything written by different parties is kept on separate cache lines.
+    constexpr std::size_t kCacheLineSize = 64;
+
+    /**
+     * Life cycle of a slot. Each transition is done by exactly one party, thus a slot is always owned by either one
+     * producer or one worker of the daemon and the data of the slot needs no further synchronisation:
+     *
+     * kFree -(producer, CAS of `SlotHeader::owner_pid`)-> kWriting -(producer)-> kReady -(worker, CAS)-> kProcessing -(worker)-> kDone -(producer)-> kFree
+     *
+     * Slots which a producer still owned when it died (i.e. in kWriting or kDone) are freed by the daemon, see
+     * `SharedRing::ReclaimAbandonedSlots`.
+     */
+    enum class SlotState : std::uint32_t {
+        kFree,
+        kWriting,
+        kReady,
+        kProcessing,
+        kDone,
+    };
+
+    static_assert(std::atomic<SlotState>::is_always_lock_free && std::atomic<std::int32_t>::is_always_lock_free && std::atomic<std::uint64_t>::is_always_lock_free,
+                  "the atomics in the shared memory must be lock-free to work across processes");
+
+    /// Description and results of the frame in a slot. The pixels are stored separately, see `SharedRing::GetFrameData`.
+    struct alignas(kCacheLineSize) SlotHeader {
+        std::atomic<SlotState> state;
+
+        /// Process ID of the producer which acquired the slot, 0 while the slot is free.
+        std::atomic<std::int32_t> owner_pid;
+
+        /// Order in which the frames have been published, the daemon analyses the oldest frame first.
+        /// Atomic as the workers look at it while searching for the oldest frame, even if they don't own the slot.
+        std::atomic<std::uint64_t> sequence;
+
+        std::int32_t width;
+        std::int32_t height;
+        std::uint64_t stride;
+        banana_pixel_format_t format;
+
+        /// `std::chrono::steady_clock` time (in ns), which is the same for all processes on the machine.
+        std::int64_t published_at_ns;
+        std::int64_t finished_at_ns;
+
+        /// The outcome of the analysis.
+        banana_status_t status;
+        /// Number of bananas found, only the first `kMaxResultsPerSlot` of them are stored in `results`.
+        std::uint64_t num_results;
+        banana_result_t results[kMaxResultsPerSlot];
+    };
+
+    /// Start of the shared memory, followed by the slot headers and then the frame data of each slot.
+    struct alignas(kCacheLineSize) RingHeader {
+        std::uint32_t magic;
+        std::uint32_t layout_version;
+        std::uint32_t num_slots;
+        /// Size (in bytes) of the frame data of each slot.
+        std::uint64_t frame_capacity;
+
+        /// Source of `SlotHeader::sequence`.
+        alignas(kCacheLineSize) std::atomic<std::uint64_t> next_sequence;
+
+        /// Statistics maintained by the daemon.
+        alignas(kCacheLineSize) std::atomic<std::uint64_t> processed_frames;
+        std::atomic<std::uint64_t> failed_frames;
+    };
+
+    /**
+     * A mapping of the shared memory of the ring buffer.
+     *
+     * The daemon creates (and in the end removes) the shared memory object, the producers open it. The frames are
+     * written directly into the shared memory by the producers and analysed in place by the daemon.
+     */
+    class SharedRing {
+    public:
+        /**
+         * Create the shared memory object and initialise it. The daemon holds a lock file for the name as long as the
+         * object exists, an existing object with the same name is thus only replaced if its daemon is no longer running.
+         *
+         * @param name name of the shared memory object (see `shm_open`), e.g. "/banana-frames".
+         * @param num_slots number of frames which can be in the ring buffer at the same time.
+         * @param frame_capacity maximum size of a frame (in bytes).
+         * @throws std::system_error if the shared memory can't be created.
+         * @throws std::runtime_error if another daemon is already running with the same name.
+         */
+        [[nodiscard]]
+        static auto Create(std::string const& name, std::uint32_t num_slots, std::uint64_t frame_capacity) -> SharedRing;
+
+        /**
+         * Open a shared memory object created by the daemon.
+         *
+         * @throws std::system_error if the shared memory can't be opened.
+         * @throws std::runtime_error if it hasn't been created by a compatible daemon or isn't completely initialised yet.
+         */
+        [[nodiscard]]
+        static auto Open(std::string const& name) -> SharedRing;
+
+        SharedRing(SharedRing&& other) noexcept;
+        SharedRing(SharedRing const&) = delete;
+        auto operator=(SharedRing const&) -> SharedRing& = delete;
+        auto operator=(SharedRing&&) -> SharedRing& = delete;
+
+        /// Unmaps the shared memory. The creator also removes the shared memory object and releases its lock.
+        ~SharedRing();
+
+        [[nodiscard]]
+        auto GetHeader() const -> RingHeader&;
+
+        [[nodiscard]]
+        auto GetSlot(std::uint32_t slot) const -> SlotHeader&;
+
+        /// The memory for the pixels of the frame in the slot, `RingHeader::frame_capacity` bytes.
+        [[nodiscard]]
+        auto GetFrameData(std::uint32_t slot) const -> std::uint8_t*;
+
+        /// Producer: take ownership of a free slot (`kFree` -> `kWriting`). Returns nothing if all slots are in use.
+        [[nodiscard]]
+        auto TryAcquireSlot() const -> std::optional<std::uint32_t>;
+
+        /// Producer: hand the frame written to the slot over to the daemon (`kWriting` -> `kReady`).
+        void Publish(std::uint32_t slot, std::int32_t width, std::int32_t height, std::uint64_t stride, banana_pixel_format_t format) const;
+
+        /// Producer: whether the analysis of the frame in the slot has finished (`kDone`), its results can then be read.
+        [[nodiscard]]
+        auto IsDone(std::uint32_t slot) const -> bool;
+
+        /// Producer: give the slot back after reading the results (`kDone` -> `kFree`) or after failing to write a frame (`kWriting` -> `kFree`).
+        void Release(std::uint32_t slot) const;
+
+        /// Daemon: take ownership of the oldest published frame (`kReady` -> `kProcessing`). Returns nothing if there is none.
+        [[nodiscard]]
+        auto TryClaimOldestReady() const -> std::optional<std::uint32_t>;
+
+        /// Daemon: hand the results back to the producer (`kProcessing` -> `kDone`).
+        void Complete(std::uint32_t slot) const;
+
+        /**
+         * Daemon: free the slots of producers which died while owning them, which would otherwise never be released.
+         * Slots with a frame which has been handed over to the daemon are only freed once the frame has been analysed.
+         * Must not be called by multiple threads at the same time.
+         *
+         * @return the number of slots which have been freed.
+         */
+        auto ReclaimAbandonedSlots() const -> std::uint32_t;
+
+        /// Number of slots currently in the given state.
+        [[nodiscard]]
+        auto CountSlots(SlotState state) const -> std::uint32_t;
+
+    private:
+        SharedRing(std::string name, void* memory, std::size_t size, int lock_fd);
+
+        std::string name_;
+        void* memory_;
+        std::size_t size_;
+        /// The lock file if this instance created the shared memory object (and is thus responsible for removing it), -1 otherwise.
+        int lock_fd_;
+    };
+
+    /// Size of the shared memory needed for the ring buffer.
+    [[nodiscard]]
+    auto GetSharedMemorySize(std::uint32_t num_slots, std::uint64_t frame_capacity) -> std::size_t;
+
+    /// Current time of `std::chrono::steady_clock` in ns, as used for the timestamps in the slots.
+    [[nodiscard]]
+    auto GetTimestampNs() -> std::int64_t;
+
+}
+
+#endif //BANANA_PROJECT_SHARED_RING_HPP
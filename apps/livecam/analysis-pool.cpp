@@ -0,0 +1,169 @@
+#include <algorithm>
+#include <exception>
+#include <format>
+#include <string_view>
+#include <utility>
+
+#include "analysis-pool.hpp"
+
+namespace livecam {
+
+    /// Weight of the newest sample in the smoothed statistics (exponential moving average).
+    constexpr double kSmoothingFactor = 0.1;
+
+    AnalysisPool::AnalysisPool(AnalyzeFunction analyze_function, std::size_t const num_sources, std::size_t const num_workers, ResultFunction result_function)
+            : analyze_function_(std::move(analyze_function)), result_function_(std::move(result_function)), sources_(num_sources) {
+        workers_.reserve(num_workers);
+        for (std::size_t i = 0; i < num_workers; ++i) {
+            workers_.emplace_back([this](std::stop_token const& stop_token) { this->WorkerLoop(stop_token); });
+        }
+    }
+
+    void AnalysisPool::Submit(std::size_t const source, cv::Mat frame, Clock::time_point const captured_at) {
+        {
+            std::scoped_lock const lock{mutex_};
+            auto& state = sources_.at(source);
+            if (state.pending) {
+                ++state.dropped_frames;
+            }
+            state.pending = PendingFrame{
+                .frame_number = state.captured_frames++,
+                .captured_at = captured_at,
+                .frame = std::move(frame),
+            };
+        }
+        work_available_.notify_one();
+    }
+
+    auto AnalysisPool::WaitForFreeSlot(std::size_t const source, std::stop_token const& stop_token) -> bool {
+        std::unique_lock lock{mutex_};
+        return slot_freed_.wait(lock, stop_token, [this, source] { return !sources_.at(source).pending; });
+    }
+
+    auto AnalysisPool::TakeResult(std::size_t const source) -> std::optional<SourceResult> {
+        std::scoped_lock const lock{mutex_};
+        return std::exchange(sources_.at(source).latest_result, std::nullopt);
+    }
+
+    auto AnalysisPool::IsIdle(std::size_t const source) const -> bool {
+        std::scoped_lock const lock{mutex_};
+        auto const& state = sources_.at(source);
+        return !state.pending && !state.in_flight;
+    }
+
+    auto AnalysisPool::GetStats(std::size_t const source) const -> SourceStats {
+        std::scoped_lock const lock{mutex_};
+        auto const& state = sources_.at(source);
+        return {
+            .captured_frames = state.captured_frames,
+            .analyzed_frames = state.analyzed_frames,
+            .dropped_frames = state.dropped_frames,
+            .reused_frames = state.reused_frames,
+            .failed_frames = state.failed_frames,
+            .fps = state.mean_frame_interval_s > 0 ? 1 / state.mean_frame_interval_s : 0,
+            .mean_latency_ms = state.mean_latency_ms,
+            .max_latency_ms = state.max_latency_ms,
+        };
+    }
+
+    auto AnalysisPool::NextSource() -> std::optional<std::size_t> {
+        for (std::size_t i = 0; i < sources_.size(); ++i) {
+            auto const source = (next_source_ + i) % sources_.size();
+            auto const& state = sources_[source];
+            if (state.pending && !state.in_flight) {
+                next_source_ = (source + 1) % sources_.size();
+                return source;
+            }
+        }
+        return std::nullopt;
+    }
+
+    void AnalysisPool::RecordResult(SourceState& state, SourceResult&& result) {
+        auto const finished_at = result.captured_at + result.latency;
+        auto const latency_ms = std::chrono::duration<double, std::milli>(result.latency).count();
+
+        if (state.last_finished_at) {
+            auto const interval_s = std::chrono::duration<double>(finished_at - *state.last_finished_at).count();
+            state.mean_frame_interval_s = state.analyzed_frames == 1
+                    ? interval_s
+                    : (1 - kSmoothingFactor) * state.mean_frame_interval_s + kSmoothingFactor * interval_s;
+        }
+        state.mean_latency_ms = state.analyzed_frames == 0
+                ? latency_ms
+                : (1 - kSmoothingFactor) * state.mean_latency_ms + kSmoothingFactor * latency_ms;
+        state.max_latency_ms = std::max(state.max_latency_ms, latency_ms);
+
+        ++state.analyzed_frames;
+        if (result.analysis.is_reused) {
+            ++state.reused_frames;
+        }
+        if (!result.analysis.result) {
+            ++state.failed_frames;
+        }
+        state.last_finished_at = finished_at;
+        state.latest_result = std::move(result);
+    }
+
+    auto AnalysisPool::Process(std::size_t const source, PendingFrame const& job) const -> SourceResult {
+        // an exception escaping the worker would terminate the whole process, i.e. stop all sources
+        auto const to_failure = [](std::string_view const what) -> FrameAnalysis {
+            try {
+                throw;
+            } catch (std::exception const& ex) {
+                return {.result = std::unexpected{std::format("{} failed: {}", what, ex.what())}};
+            } catch (...) {
+                return {.result = std::unexpected{std::format("{} failed with an unknown exception", what)}};
+            }
+        };
+
+        SourceResult result{
+            .frame_number = job.frame_number,
+            .captured_at = job.captured_at,
+            .latency = {},
+            .analysis = {},
+        };
+        try {
+            result.analysis = analyze_function_(source, job.frame, job.captured_at);
+        } catch (...) {
+            result.analysis = to_failure("the analysis");
+        }
+        result.latency = Clock::now() - job.captured_at;
+
+        // still in flight, thus no other worker calls it for the same source in the meantime
+        if (result_function_) {
+            try {
+                result_function_(source, result);
+            } catch (...) {
+                result.analysis = to_failure("handling the result");
+            }
+        }
+        return result;
+    }
+
+    void AnalysisPool::WorkerLoop(std::stop_token const& stop_token) {
+        std::unique_lock lock{mutex_};
+        while (true) {
+            std::optional<std::size_t> source;
+            if (!work_available_.wait(lock, stop_token, [this, &source] { return (source = this->NextSource()).has_value(); })) {
+                return; // stop has been requested
+            }
+
+            auto& state = sources_[*source];
+            auto job = std::move(*state.pending);
+            state.pending.reset();
+            state.in_flight = true;
+            slot_freed_.notify_all();
+
+            lock.unlock();
+            auto result = this->Process(*source, job);
+            lock.lock();
+
+            state.in_flight = false;
+            this->RecordResult(state, std::move(result));
+
+            // a newer frame of this source may have arrived in the meantime which no other worker could pick up so far
+            work_available_.notify_one();
+        }
+    }
+
+}
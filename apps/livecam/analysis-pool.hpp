@@ -0,0 +1,208 @@
+#ifndef BANANA_PROJECT_ANALYSIS_POOL_HPP
+#define BANANA_PROJECT_ANALYSIS_POOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <expected>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <banana-lib/lib.hpp>
+
+#include "latency-governor.hpp"
+
+namespace livecam {
+
+    using Clock = std::chrono::steady_clock;
+
+    /// The analysis of a single frame, as produced by the function passed to the `AnalysisPool`.
+    struct FrameAnalysis {
+        /// The annotated results or a description of why the frame couldn't be analysed.
+        std::expected<banana::AnnotatedAnalysisResult, std::string> result;
+
+        /// Whether the results of a previous frame have been reused instead of analysing this one (e.g. because the scene didn't change).
+        bool is_reused{false};
+
+        /// The quality with which the frame has been analysed, see `LatencyGovernor`.
+        QualityLevel quality_level{QualityLevel::kFull};
+    };
+
+    /**
+     * Function called by the workers to analyse a frame of a source, which has been captured at `captured_at`.
+     * It will never be called concurrently for the same source, but it will be called concurrently for different sources.
+     * Exceptions are caught by the worker and turn into a failed analysis of the frame.
+     */
+    typedef std::function<FrameAnalysis(std::size_t source, cv::Mat const& frame, Clock::time_point captured_at)> AnalyzeFunction;
+
+    /// The result of analysing one frame of a source.
+    struct SourceResult {
+        /// Sequential number of the frame (counted per source, starting at 0, including dropped frames).
+        std::size_t frame_number;
+
+        /// When the frame has been captured.
+        Clock::time_point captured_at;
+
+        /// How long it took from capturing the frame until the analysis finished.
+        Clock::duration latency;
+
+        /// The result of the analysis.
+        FrameAnalysis analysis;
+    };
+
+    /**
+     * Function called by the workers with every finished result of a source, in the order of the frames, including the
+     * results which are replaced by a newer one before `AnalysisPool::TakeResult` picks them up.
+     * Like the `AnalyzeFunction` it will never be called concurrently for the same source, and an exception turns the
+     * result into a failed analysis.
+     */
+    typedef std::function<void(std::size_t source, SourceResult const& result)> ResultFunction;
+
+    /// Statistics for a single source.
+    struct SourceStats {
+        /// Number of frames which have been submitted for this source.
+        std::size_t captured_frames;
+
+        /// Number of frames which have been analysed.
+        std::size_t analyzed_frames;
+
+        /// Number of frames which have been replaced by a newer frame before a worker could pick them up.
+        std::size_t dropped_frames;
+
+        /// Number of frames for which the results of a previous frame have been reused. These are included in `analyzed_frames`.
+        std::size_t reused_frames;
+
+        /// Number of frames whose analysis failed (including exceptions). These are included in `analyzed_frames`.
+        std::size_t failed_frames;
+
+        /// Smoothed rate of analysed frames (in frames per second).
+        double fps;
+
+        /// Smoothed latency from capturing a frame until its analysis finished (in milliseconds).
+        double mean_latency_ms;
+
+        /// Highest latency observed so far (in milliseconds).
+        double max_latency_ms;
+    };
+
+    /**
+     * A pool of worker threads which analyse the frames of multiple sources.
+     *
+     * Each source has a single slot for its latest frame: submitting a new frame replaces a frame which hasn't been picked
+     * up yet (it is counted as dropped). The workers serve the sources in round-robin order and at most one frame per
+     * source is being analysed at any time, thus a source delivering frames faster than they can be analysed can not
+     * starve the other sources.
+     */
+    class AnalysisPool {
+    public:
+        /**
+         * Create the pool and start the workers.
+         *
+         * @param analyze_function the function used to analyse a frame.
+         * @param num_sources the number of sources which will submit frames.
+         * @param num_workers the number of worker threads to start.
+         * @param result_function optional function receiving every result (e.g. to record them all).
+         */
+        AnalysisPool(AnalyzeFunction analyze_function, std::size_t num_sources, std::size_t num_workers, ResultFunction result_function = {});
+
+        AnalysisPool(AnalysisPool const&) = delete;
+        auto operator=(AnalysisPool const&) -> AnalysisPool& = delete;
+
+        /**
+         * Submit a new frame of a source for analysis. Replaces any frame of this source which is still waiting.
+         *
+         * @param source the index of the source.
+         * @param frame the captured frame.
+         * @param captured_at when the frame has been captured.
+         */
+        void Submit(std::size_t source, cv::Mat frame, Clock::time_point captured_at);
+
+        /**
+         * Block until the slot of the source is free again, i.e. until the previously submitted frame has been picked up.
+         * Use this for sources where no frame should be dropped (e.g. video files).
+         *
+         * @return `false` if the wait has been aborted through the stop token.
+         */
+        auto WaitForFreeSlot(std::size_t source, std::stop_token const& stop_token) -> bool;
+
+        /**
+         * Take the latest finished result of a source (if there is any new one since the last call).
+         * Older results which have never been taken are discarded.
+         */
+        [[nodiscard]]
+        auto TakeResult(std::size_t source) -> std::optional<SourceResult>;
+
+        /// Whether the source neither has a frame waiting nor one being analysed.
+        [[nodiscard]]
+        auto IsIdle(std::size_t source) const -> bool;
+
+        [[nodiscard]]
+        auto GetStats(std::size_t source) const -> SourceStats;
+
+    private:
+        /// A frame waiting to be analysed.
+        struct PendingFrame {
+            std::size_t frame_number;
+            Clock::time_point captured_at;
+            cv::Mat frame;
+        };
+
+        /// Book-keeping per source. Protected by `mutex_`.
+        struct SourceState {
+            std::optional<PendingFrame> pending;
+            bool in_flight{false};
+            std::optional<SourceResult> latest_result;
+            std::size_t captured_frames{0};
+            std::size_t analyzed_frames{0};
+            std::size_t dropped_frames{0};
+            std::size_t reused_frames{0};
+            std::size_t failed_frames{0};
+            std::optional<Clock::time_point> last_finished_at;
+            double mean_frame_interval_s{0};
+            double mean_latency_ms{0};
+            double max_latency_ms{0};
+        };
+
+        /**
+         * Pick the next source to be served: the first one after the previously served source which has a frame waiting
+         * and none being analysed. Must be called with `mutex_` held.
+         */
+        [[nodiscard]]
+        auto NextSource() -> std::optional<std::size_t>;
+
+        /// Record a finished analysis in the state of the source. Must be called with `mutex_` held.
+        void RecordResult(SourceState& state, SourceResult&& result);
+
+        /// Analyse a frame and pass the result to the result function, exceptions of both turn into a failed result.
+        [[nodiscard]]
+        auto Process(std::size_t source, PendingFrame const& job) const -> SourceResult;
+
+        void WorkerLoop(std::stop_token const& stop_token);
+
+        AnalyzeFunction const analyze_function_;
+        ResultFunction const result_function_;
+
+        mutable std::mutex mutex_;
+        /// Signalled when a frame has been submitted or an analysis finished (which may unblock another frame of the source).
+        std::condition_variable_any work_available_;
+        /// Signalled when a worker picked up a frame.
+        std::condition_variable_any slot_freed_;
+
+        std::vector<SourceState> sources_;
+        /// The source at which `NextSource` starts looking, used for the round-robin scheduling.
+        std::size_t next_source_{0};
+
+        /// Must be the last member so that the workers are stopped before anything they use is destroyed.
+        std::vector<std::jthread> workers_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_ANALYSIS_POOL_HPP
@@ -0,0 +1,31 @@
+#include <utility>
+
+#include "frame-selector.hpp"
+
+namespace livecam {
+
+    FrameSelector::FrameSelector(std::optional<banana::SceneChangeDetector::Settings> scene_change_detector) {
+        if (scene_change_detector) {
+            detector_.emplace(std::move(*scene_change_detector));
+        }
+    }
+
+    auto FrameSelector::NeedsAnalysis(cv::Mat const& frame, QualityLevel const level) -> bool {
+        if (level != QualityLevel::kSkipFrames) {
+            // start with an analysed frame once frames are skipped again
+            skip_next_frame_ = false;
+        } else if (std::exchange(skip_next_frame_, !skip_next_frame_)) {
+            // not shown to the detector, otherwise it would become the reference without having been analysed
+            return false;
+        }
+
+        return !detector_ || detector_->NeedsAnalysis(frame);
+    }
+
+    void FrameSelector::Reset() {
+        if (detector_) {
+            detector_->Reset();
+        }
+    }
+
+}
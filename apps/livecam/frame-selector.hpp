@@ -0,0 +1,47 @@
+#ifndef BANANA_PROJECT_FRAME_SELECTOR_HPP
+#define BANANA_PROJECT_FRAME_SELECTOR_HPP
+
+#include <optional>
+
+#include <opencv2/opencv.hpp>
+
+#include <banana-lib/scene-change-detector.hpp>
+
+#include "latency-governor.hpp"
+
+namespace livecam {
+
+    /**
+     * Decides which frames of a source are analysed and which reuse the results of the last analysed frame, either
+     * because the scene didn't change (scene gating) or because the quality level skips every second frame.
+     *
+     * The scene change detector is only asked for frames which aren't skipped anyway, thus its reference is always a
+     * frame which has actually been analysed and a change on a skipped frame is still detected on the next frame.
+     *
+     * Not thread-safe: use one selector per source (the `AnalysisPool` never analyses two frames of a source concurrently).
+     */
+    class FrameSelector {
+    public:
+        /// @param scene_change_detector the settings of the scene change detector or none to disable the scene gating.
+        explicit FrameSelector(std::optional<banana::SceneChangeDetector::Settings> scene_change_detector);
+
+        /**
+         * Check whether a frame needs to be analysed with the given level or whether the results of the last analysed
+         * frame should be reused.
+         */
+        [[nodiscard]]
+        auto NeedsAnalysis(cv::Mat const& frame, QualityLevel level) -> bool;
+
+        /// Use this if the analysis of a frame for which `NeedsAnalysis` returned `true` failed, the next frame is then analysed.
+        void Reset();
+
+    private:
+        std::optional<banana::SceneChangeDetector> detector_;
+
+        /// Whether the next frame is skipped while only every second frame is analysed (see `QualityLevel::kSkipFrames`).
+        bool skip_next_frame_{false};
+    };
+
+}
+
+#endif //BANANA_PROJECT_FRAME_SELECTOR_HPP
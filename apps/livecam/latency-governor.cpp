@@ -0,0 +1,53 @@
+#include <utility>
+
+#include "latency-governor.hpp"
+
+namespace livecam {
+
+    /// Weight of the newest sample in the smoothed latency (exponential moving average).
+    constexpr double kLatencySmoothingFactor = 0.2;
+
+    auto ToString(QualityLevel const level) -> std::string {
+        switch (level) {
+            case QualityLevel::kFull:
+                return "full";
+            case QualityLevel::kNoVerboseAnnotations:
+                return "no verbose annotations";
+            case QualityLevel::kHalfResolution:
+                return "half resolution";
+            case QualityLevel::kSkipFrames:
+                return "half resolution, every second frame";
+        }
+        return "unknown";
+    }
+
+    LatencyGovernor::LatencyGovernor(Settings settings) : settings_(std::move(settings)) {
+    }
+
+    auto LatencyGovernor::GetLevel() const -> QualityLevel {
+        return level_;
+    }
+
+    void LatencyGovernor::Report(std::chrono::steady_clock::duration const latency) {
+        auto const latency_s = std::chrono::duration<double>(latency).count();
+        mean_latency_s_ = frames_at_level_ == 0
+                ? latency_s
+                : (1 - kLatencySmoothingFactor) * mean_latency_s_ + kLatencySmoothingFactor * latency_s;
+        ++frames_at_level_;
+
+        if (frames_at_level_ < settings_.hold_frames) {
+            return;
+        }
+
+        auto const target_s = std::chrono::duration<double>(settings_.target_latency).count();
+        auto const level = static_cast<std::uint8_t>(level_);
+        if (mean_latency_s_ > target_s && level_ != QualityLevel::kSkipFrames) {
+            level_ = static_cast<QualityLevel>(level + 1);
+            frames_at_level_ = 0;
+        } else if (mean_latency_s_ < settings_.raise_threshold * target_s && level_ != QualityLevel::kFull) {
+            level_ = static_cast<QualityLevel>(level - 1);
+            frames_at_level_ = 0;
+        }
+    }
+
+}
@@ -0,0 +1,75 @@
+#ifndef BANANA_PROJECT_LATENCY_GOVERNOR_HPP
+#define BANANA_PROJECT_LATENCY_GOVERNOR_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace livecam {
+
+    /// How much of the analysis is done for a frame, from the best results to the fastest analysis.
+    enum class QualityLevel : std::uint8_t {
+        /// Everything, as configured.
+        kFull,
+        /// Only the contours are annotated, without the verbose annotations.
+        kNoVerboseAnnotations,
+        /// The bananas are detected on an image with half the resolution (i.e. a quarter of the pixels and contour points).
+        kHalfResolution,
+        /// Like `kHalfResolution`, but only every second frame is analysed. The other frames reuse the previous results.
+        kSkipFrames,
+    };
+
+    [[nodiscard]]
+    auto ToString(QualityLevel level) -> std::string;
+
+    /**
+     * Adapts the quality of the analysis of a source to keep its latency (from capturing a frame until its analysis
+     * finished) below a target.
+     *
+     * The latency is smoothed over several frames. If it exceeds the target the quality is lowered by one level, if it
+     * stays well below the target the quality is raised again. After each change the new level is kept for a few frames
+     * so that its effect can be measured before changing it again.
+     *
+     * Not thread-safe: use one governor per source (the `AnalysisPool` never analyses two frames of a source concurrently).
+     */
+    class LatencyGovernor {
+    public:
+        struct Settings {
+            /// The latency which should not be exceeded.
+            std::chrono::steady_clock::duration target_latency;
+
+            /// The quality is only raised again if the smoothed latency is below this fraction of the target.
+            double raise_threshold{0.6};
+
+            /// Number of frames for which a level is kept after it has been changed.
+            std::size_t hold_frames{10};
+        };
+
+        explicit LatencyGovernor(Settings settings);
+
+        /// The level with which the next frame should be analysed.
+        [[nodiscard]]
+        auto GetLevel() const -> QualityLevel;
+
+        /**
+         * Record the latency of a frame which has been analysed with the current level and adapt the level if needed.
+         * Frames which reuse the results of a previous frame must not be reported, they say nothing about the analysis.
+         */
+        void Report(std::chrono::steady_clock::duration latency);
+
+    private:
+        Settings const settings_;
+
+        QualityLevel level_{QualityLevel::kFull};
+
+        /// Smoothed latency (in seconds) since the last change of the level.
+        double mean_latency_s_{0};
+
+        /// Number of frames reported since the last change of the level.
+        std::size_t frames_at_level_{0};
+    };
+
+}
+
+#endif //BANANA_PROJECT_LATENCY_GOVERNOR_HPP
@@ -1,74 +1,418 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <expected>
 #include <filesystem>
 #include <format>
+#include <functional>
 #include <iostream>
+#include <list>
+#include <memory>
+#include <optional>
+#include <ranges>
 #include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <opencv2/opencv.hpp>
 #include <opencv2/core/utils/logger.hpp>
 
 #include <banana-lib/lib.hpp>
+#include <banana-lib/result-bus.hpp>
+#include <banana-lib/scene-change-detector.hpp>
+
+#include "analysis-pool.hpp"
+#include "frame-selector.hpp"
+#include "latency-governor.hpp"
+#include "video-recorder.hpp"
 
 const cv::Size kWindowSize{768, 512};
 
+/// Calibration of the camera: measured 29cm = 580px.
+constexpr double kPixelsPerMeter = 2000;
+
+/// Number of frames kept on the result bus of each source, i.e. how far a reader of the bus may fall behind.
+constexpr std::size_t kResultBusCapacity = 64;
+
+/// Frame rate of the recordings of sources which don't report their own frame rate.
+constexpr double kDefaultRecordingFps = 25;
+
+/// A camera, video file or stream from which frames are being analysed.
+struct VideoSource {
+    /// The argument through which the source has been specified, used to identify it to the user.
+    std::string name;
+    cv::VideoCapture capture;
+    /// Whether this is a recording (e.g. a video file) rather than a live source. No frames are dropped for recordings.
+    bool is_recording;
+};
+
+/// The command line arguments.
+struct Arguments {
+    std::vector<std::string> sources;
+    std::size_t num_workers;
+    /// Whether frames showing the same scene as the last analysed frame are skipped.
+    bool scene_gating;
+    /// See `banana::SceneChangeDetector::Settings::changed_cells_threshold`.
+    double scene_change_threshold;
+    /// See `banana::SceneChangeDetector::Settings::max_skipped_frames`.
+    std::size_t refresh_interval;
+    /// Directory to which the annotated frames and their results are recorded, if set.
+    std::optional<std::filesystem::path> record_directory;
+    /// Maximum number of frames per source waiting to be encoded, further frames are dropped from the recording.
+    std::size_t record_queue_size;
+    /// The latency which the analysis of each source should keep by lowering its quality, if set.
+    std::optional<std::chrono::milliseconds> target_latency;
+};
+
+/// The state of the analysis of a source which is kept between its frames.
+struct SourceAnalysisState {
+    /// Decides which frames are analysed and which reuse the results of the last analysed frame.
+    livecam::FrameSelector selector;
+    /// The results of the last analysed frame.
+    std::list<banana::AnalysisResult> last_results;
+    /// Adapts the quality of the analysis to the target latency, if one has been set.
+    std::optional<livecam::LatencyGovernor> governor;
+};
+
 [[nodiscard]]
-auto GetVideoCaptureFromArgs(int const argc, char const * const argv[]) -> cv::VideoCapture {
-    if(argc > 2) {
-        throw std::runtime_error(std::format("expected 0 or 1 arguments but got {}!", argc-1));
-    } else if(argc == 2) {
-        try {
-            // numeric value => it's the index of a video device
-            return cv::VideoCapture{std::stoi(argv[1])};
-        } catch (std::invalid_argument const& ex) {
-            // non-numeric value => treat it as a path, url or similar and let OpenCV check if it's valid
-            return cv::VideoCapture{argv[1]};
+auto GetArgumentsFromArgs(int const argc, char const * const argv[]) -> Arguments {
+    Arguments arguments{
+        .sources = {},
+        .num_workers = std::max(1u, std::thread::hardware_concurrency()),
+        .scene_gating = true,
+        .scene_change_threshold = banana::SceneChangeDetector::Settings{}.changed_cells_threshold,
+        .refresh_interval = banana::SceneChangeDetector::Settings{}.max_skipped_frames,
+        .record_directory = std::nullopt,
+        .record_queue_size = 32,
+        .target_latency = std::nullopt,
+    };
+
+    auto const get_value = [&](int& i) -> std::string {
+        if (i + 1 >= argc) {
+            throw std::runtime_error(std::format("missing value for {}!", argv[i]));
+        }
+        return argv[++i];
+    };
+
+    for (int i = 1; i < argc; ++i) {
+        std::string const arg{argv[i]};
+        if (arg == "--workers") {
+            arguments.num_workers = std::stoul(get_value(i));
+            if (arguments.num_workers == 0) {
+                throw std::runtime_error("at least one worker is needed!");
+            }
+        } else if (arg == "--no-scene-gating") {
+            arguments.scene_gating = false;
+        } else if (arg == "--scene-change-threshold") {
+            arguments.scene_change_threshold = std::stod(get_value(i));
+        } else if (arg == "--refresh-interval") {
+            arguments.refresh_interval = std::stoul(get_value(i));
+        } else if (arg == "--target-latency") {
+            arguments.target_latency = std::chrono::milliseconds{std::stol(get_value(i))};
+            if (arguments.target_latency->count() <= 0) {
+                throw std::runtime_error("the target latency must be positive!");
+            }
+        } else if (arg == "--record") {
+            arguments.record_directory = get_value(i);
+        } else if (arg == "--record-queue-size") {
+            arguments.record_queue_size = std::stoul(get_value(i));
+            if (arguments.record_queue_size == 0) {
+                throw std::runtime_error("the record queue needs space for at least one frame!");
+            }
+        } else {
+            arguments.sources.push_back(arg);
         }
-    } else { // argc == 1
-        return cv::VideoCapture{0};
     }
+
+    if (arguments.sources.empty()) {
+        arguments.sources.emplace_back("0");
+    }
+
+    return arguments;
 }
 
-void ShowAnalysisResult(banana::AnnotatedAnalysisResult const& analysis_result) {
-    std::string const windowName = "analysis result | press q to quit";
+[[nodiscard]]
+auto OpenVideoSource(std::string const& arg) -> VideoSource {
+    cv::VideoCapture capture;
+    try {
+        // numeric value => it's the index of a video device
+        capture.open(std::stoi(arg));
+    } catch (std::invalid_argument const& ex) {
+        // non-numeric value => treat it as a path, url or similar and let OpenCV check if it's valid
+        capture.open(arg);
+    }
+
+    if (!capture.isOpened()) {
+        throw std::runtime_error(std::format("can't open video source {}", arg));
+    }
+
+    // live sources (cameras, streams) don't know how many frames they have
+    auto const is_recording = capture.get(cv::CAP_PROP_FRAME_COUNT) > 0;
+    return {arg, std::move(capture), is_recording};
+}
+
+/**
+ * Read frames from the source and submit them to the pool until the source has no more frames or stop is requested.
+ */
+void CaptureFrames(std::stop_token const& stop_token, std::size_t const source_index, VideoSource& source,
+                   livecam::AnalysisPool& pool, std::atomic<bool>& finished) {
+    while (!stop_token.stop_requested()) {
+        if (source.is_recording && !pool.WaitForFreeSlot(source_index, stop_token)) {
+            break;
+        }
+
+        cv::Mat frame;
+        source.capture >> frame;
+        if (frame.empty()) {
+            break;
+        }
+        pool.Submit(source_index, std::move(frame), livecam::Clock::now());
+    }
+    finished = true;
+}
+
+/// Scale the result of an analysis done on a resized image to the original image.
+void ScaleResult(banana::AnalysisResult& result, double const factor) {
+    auto const scale_point = [factor](cv::Point const& p) -> cv::Point {
+        return {cvRound(p.x * factor), cvRound(p.y * factor)};
+    };
+    std::ranges::transform(result.contour, result.contour.begin(), scale_point);
+    result.estimated_center = scale_point(result.estimated_center);
+
+    // y = a0 + a1 * x + a2 * x^2 with x = X / factor and y = Y / factor => Y = factor * a0 + a1 * X + a2 / factor * X^2
+    auto& [coeff_0, coeff_1, coeff_2] = result.center_line.coefficients;
+    coeff_0 *= factor;
+    coeff_2 /= factor;
+    for (auto& point : result.center_line.points_in_banana_coordsys) {
+        point *= factor;
+    }
+}
+
+/**
+ * Detect the bananas on a copy of the frame with half the resolution, which is roughly four times faster. The results
+ * are scaled back to the frame, the sizes (in meters) are not affected as the calibration of the analyzer is adapted.
+ *
+ * @param half_resolution_analyzer analyzer with `pixels_per_meter` and the areas adapted to the half resolution.
+ * @param annotating_analyzer analyzer used to annotate the frame.
+ * @param frame the frame to be analysed.
+ */
+[[nodiscard]]
+auto AnalyzeAtHalfResolution(banana::Analyzer const& half_resolution_analyzer, banana::Analyzer const& annotating_analyzer, cv::Mat const& frame)
+        -> std::expected<banana::AnnotatedAnalysisResult, banana::AnalysisError> {
+    cv::Mat half_resolution_frame;
+    cv::resize(frame, half_resolution_frame, {}, 0.5, 0.5, cv::INTER_AREA);
+
+    return half_resolution_analyzer.AnalyzeImage(half_resolution_frame)
+        .transform([&](auto&& results) -> banana::AnnotatedAnalysisResult {
+            for (auto& result : results) {
+                ScaleResult(result, 2);
+            }
+            return {annotating_analyzer.AnnotateImage(frame, results), std::move(results)};
+        });
+}
+
+void ShowAnalysisResult(std::size_t const source_index, VideoSource const& source, banana::AnnotatedAnalysisResult const& analysis_result) {
+    std::string const windowName = std::format("#{}: {} | press q to quit", source_index, source.name);
     cv::namedWindow(windowName, cv::WINDOW_KEEPRATIO);
     cv::imshow(windowName, analysis_result.annotated_image);
     cv::resizeWindow(windowName, kWindowSize);
 }
 
+/**
+ * Create a recorder for each source, writing `source-<n>.avi` and `source-<n>.jsonl` into the directory.
+ * Must be called before the capturing starts as the frame rate is read from the sources.
+ */
+[[nodiscard]]
+auto CreateRecorders(std::filesystem::path const& directory, std::vector<VideoSource>& sources, std::size_t const queue_size)
+        -> std::vector<std::unique_ptr<livecam::VideoRecorder>> {
+    std::filesystem::create_directories(directory);
+
+    std::vector<std::unique_ptr<livecam::VideoRecorder>> recorders;
+    for (auto const& [n, source] : std::ranges::enumerate_view(sources)) {
+        auto const source_fps = source.capture.get(cv::CAP_PROP_FPS);
+        recorders.push_back(std::make_unique<livecam::VideoRecorder>(
+                directory / std::format("source-{}.avi", n),
+                directory / std::format("source-{}.jsonl", n),
+                source_fps > 0 ? source_fps : kDefaultRecordingFps,
+                queue_size));
+    }
+    return recorders;
+}
+
+void PrintStats(std::vector<VideoSource> const& sources, livecam::AnalysisPool const& pool,
+                std::vector<std::unique_ptr<banana::ResultBus>> const& result_buses,
+                std::vector<std::unique_ptr<livecam::VideoRecorder>> const& recorders) {
+    for (auto const& [n, source] : std::ranges::enumerate_view(sources)) {
+        auto const stats = pool.GetStats(n);
+        std::cout << std::format("Source #{} ({}): {:.1f} fps, latency {:.1f} ms (max {:.1f} ms), {} captured, {} analysed ({} unchanged, {} failed), {} dropped",
+                                 n, source.name, stats.fps, stats.mean_latency_ms, stats.max_latency_ms,
+                                 stats.captured_frames, stats.analyzed_frames, stats.reused_frames, stats.failed_frames, stats.dropped_frames) << std::endl;
+        if (auto const latest = result_buses[n]->ReadLatest()) {
+            std::cout << std::format("  result bus: {} frames published, {} banana(s) in the latest one",
+                                     result_buses[n]->GetPublishedFrames(), latest->num_bananas) << std::endl;
+        }
+        if (!recorders.empty()) {
+            auto const recorder_stats = recorders[n]->GetStats();
+            std::cout << std::format("  recording: {} frames written, {} dropped, {} queued",
+                                     recorder_stats.recorded_frames, recorder_stats.dropped_frames, recorder_stats.queued_frames) << std::endl;
+        }
+    }
+}
+
 int main(int const argc, char const * const argv[]) {
     cv::utils::logging::setLogLevel(cv::utils::logging::LOG_LEVEL_WARNING);
 
     banana::Analyzer const analyzer{{
         .verbose_annotations = true,
-        .pixels_per_meter = 2000, // measured 29cm = 580px
+        .pixels_per_meter = kPixelsPerMeter,
+    }};
+    // used by the latency governor to trade quality for speed, see `livecam::QualityLevel`
+    banana::Analyzer const fast_analyzer{{
+        .pixels_per_meter = kPixelsPerMeter,
+    }};
+    banana::Analyzer::Settings const default_settings{.pixels_per_meter = kPixelsPerMeter};
+    banana::Analyzer const half_resolution_analyzer{{
+        .min_area = default_settings.min_area / 4,
+        .max_area = default_settings.max_area / 4,
+        .pixels_per_meter = kPixelsPerMeter / 2,
     }};
     try {
-        auto cap = GetVideoCaptureFromArgs(argc, argv);
-        if(!cap.isOpened()) {
-            std::cerr << "can't use camera" << std::endl;
-            return 1;
+        auto const arguments = GetArgumentsFromArgs(argc, argv);
+        auto sources = arguments.sources
+                       | std::views::transform(OpenVideoSource)
+                       | std::ranges::to<std::vector>();
+
+        // the pool never analyses two frames of the same source concurrently, thus each state is only used by one worker at a time
+        std::vector<SourceAnalysisState> source_states;
+        source_states.reserve(sources.size());
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            source_states.push_back({
+                .selector = livecam::FrameSelector{arguments.scene_gating
+                        ? std::optional<banana::SceneChangeDetector::Settings>{{
+                            .changed_cells_threshold = arguments.scene_change_threshold,
+                            .max_skipped_frames = arguments.refresh_interval,
+                        }}
+                        : std::nullopt},
+                .last_results = {},
+                .governor = arguments.target_latency
+                            ? std::optional{livecam::LatencyGovernor{{.target_latency = *arguments.target_latency}}}
+                            : std::nullopt,
+            });
         }
 
-        std::cout << R"(
+        auto const analyze = [&](std::size_t const source, cv::Mat const& frame, livecam::Clock::time_point const captured_at) -> livecam::FrameAnalysis {
+            auto& state = source_states[source];
+            auto const level = state.governor ? state.governor->GetLevel() : livecam::QualityLevel::kFull;
+            auto const& level_analyzer = level == livecam::QualityLevel::kFull ? analyzer : fast_analyzer;
+
+            auto analysis = [&]() -> livecam::FrameAnalysis {
+                if (!state.selector.NeedsAnalysis(frame, level)) {
+                    return {
+                        .result = banana::AnnotatedAnalysisResult{level_analyzer.AnnotateImage(frame, state.last_results), state.last_results},
+                        .is_reused = true,
+                    };
+                }
+
+                auto result = level >= livecam::QualityLevel::kHalfResolution
+                              ? AnalyzeAtHalfResolution(half_resolution_analyzer, level_analyzer, frame)
+                              : level_analyzer.AnalyzeAndAnnotateImage(frame);
+                if (result) {
+                    state.last_results = result->banana;
+                } else {
+                    state.selector.Reset();
+                }
+                return {.result = std::move(result).transform_error([](banana::AnalysisError const error) { return error.ToString(); })};
+            }();
+
+            analysis.quality_level = level;
+            // reused results only cost the annotation, they would make the analysis look much faster than it is
+            if (state.governor && !analysis.is_reused) {
+                state.governor->Report(livecam::Clock::now() - captured_at);
+            }
+            return analysis;
+        };
+
+        // one bus per source, publishing the results of every analysed frame of it. any thread of the application can
+        // read them from there (`banana::ResultBus::Subscriber` for every frame, `ReadLatest` for the current state)
+        // without being part of the analysis loop, as `PrintStats` does.
+        std::vector<std::unique_ptr<banana::ResultBus>> result_buses;
+        for (std::size_t n = 0; n < sources.size(); ++n) {
+            result_buses.push_back(std::make_unique<banana::ResultBus>(kResultBusCapacity));
+        }
+        // declared before the pool, thus the workers are stopped before the recorders finish writing
+        auto const recorders = arguments.record_directory
+                               ? CreateRecorders(*arguments.record_directory, sources, arguments.record_queue_size)
+                               : std::vector<std::unique_ptr<livecam::VideoRecorder>>{};
+        // every result is published and recorded, not only the ones which the loop below happens to take. the pool
+        // never calls this concurrently for the same source, thus each bus only has a single publisher.
+        auto const handle_result = [&result_buses, &recorders](std::size_t const source, livecam::SourceResult const& result) {
+            if (!result.analysis.result) {
+                return;
+            }
+            result_buses[source]->Publish(result.analysis.result->banana, result.captured_at);
+            if (!recorders.empty()) {
+                recorders[source]->Submit(result);
+            }
+        };
+
+        livecam::AnalysisPool pool{analyze, sources.size(), arguments.num_workers, handle_result};
+
+        std::vector<std::atomic<bool>> finished(sources.size());
+        std::vector<std::jthread> capture_threads;
+        for (auto const& [n, source] : std::ranges::enumerate_view(sources)) {
+            capture_threads.emplace_back(CaptureFrames, n, std::ref(source), std::ref(pool), std::ref(finished[n]));
+        }
+
+        std::cout << std::format(R"(
+Analysing {} source(s) with {} worker(s).
+
 Available action keys:
-* press 'i' to show information on the bananas currently visible in the frame
+* press 'i' to show information on the bananas currently visible in the frames
+* press 's' to show statistics for each source
 * press 'q' to quit
-)" << std::endl;
+)", sources.size(), arguments.num_workers) << std::endl;
 
+        std::vector<std::optional<livecam::SourceResult>> latest_results(sources.size());
         while (true) {
-            cv::Mat frame;
-            cap >> frame;
-            auto const analysisResult = analyzer.AnalyzeAndAnnotateImage(frame);
-
-            if (analysisResult) {
-                ShowAnalysisResult(*analysisResult);
-            } else {
-                std::cerr << "failed to analyse the image: " << analysisResult.error().ToString() << std::endl;
-                return 1;
+            // checked before taking the results so that the results of the last frames are still shown
+            auto const all_finished = std::ranges::all_of(std::views::iota(0uz, sources.size()), [&](auto const n) {
+                return finished[n] && pool.IsIdle(n);
+            });
+
+            for (auto const& [n, source] : std::ranges::enumerate_view(sources)) {
+                auto result = pool.TakeResult(n);
+                if (!result) {
+                    continue;
+                }
+                if (result->analysis.result) {
+                    ShowAnalysisResult(n, source, *result->analysis.result);
+                } else {
+                    std::cerr << std::format("failed to analyse frame {} of source #{}: ", result->frame_number, n)
+                              << result->analysis.result.error() << std::endl;
+                }
+                latest_results[n] = std::move(result);
+            }
+
+            if (all_finished) {
+                std::cout << "all sources have ended" << std::endl;
+                PrintStats(sources, pool, result_buses, recorders);
+                return 0;
             }
 
-            switch (cv::pollKey()) {
+            switch (cv::waitKey(1)) {
                 case 'i':
-                    std::cout << *analysisResult;
+                    for (auto const& [n, result] : std::ranges::enumerate_view(latest_results)) {
+                        if (result && result->analysis.result) {
+                            std::cout << std::format("Source #{} ({}), frame {} (quality: {}):", n, sources[n].name, result->frame_number,
+                                                     livecam::ToString(result->analysis.quality_level)) << std::endl;
+                            std::cout << *result->analysis.result;
+                        }
+                    }
+                    break;
+                case 's':
+                    PrintStats(sources, pool, result_buses, recorders);
                     break;
                 case 'q':
                     return 0;
@@ -78,7 +422,10 @@ Available action keys:
         }
     } catch (std::exception const& ex) {
         std::cerr << ex.what() << std::endl;
-        std::cerr << "Usage: " << argv[0] << " [capture_device_id|video_path]" << std::endl;
+        std::cerr << "Usage: " << argv[0]
+                  << " [--workers N] [--no-scene-gating] [--scene-change-threshold FRACTION] [--refresh-interval FRAMES]"
+                  << " [--target-latency MS] [--record DIRECTORY] [--record-queue-size FRAMES]"
+                  << " [capture_device_id|video_path ...]" << std::endl;
         return 1;
     }
 }
@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <format>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+#include "video-recorder.hpp"
+
+namespace livecam {
+
+    namespace {
+        /// Get the codec matching the container format of a video file.
+        auto GetFourcc(std::filesystem::path const& video_path) -> int {
+            auto extension = video_path.extension().string();
+            std::ranges::transform(extension, extension.begin(), [](unsigned char const c) { return std::tolower(c); });
+            if (extension == ".avi" || extension == ".mkv") {
+                return cv::VideoWriter::fourcc('M', 'J', 'P', 'G');
+            }
+            if (extension == ".mp4") {
+                return cv::VideoWriter::fourcc('m', 'p', '4', 'v');
+            }
+            throw std::invalid_argument(std::format("unsupported video format of {}, use .avi, .mkv or .mp4", video_path.string()));
+        }
+
+        /// JSON has no representation for NaN and infinity.
+        auto FormatNumber(double const value, int const precision) -> std::string {
+            return std::isfinite(value) ? std::format("{:.{}f}", value, precision) : "null";
+        }
+
+        /// Writes the frames to a video file and their results to a sidecar file.
+        class FileWriter {
+        public:
+            FileWriter(std::filesystem::path video_path, std::filesystem::path const& sidecar_path, double const fps)
+                    : video_path_(std::move(video_path)), fourcc_(GetFourcc(video_path_)), fps_(fps), sidecar_(sidecar_path) {
+                if (!sidecar_) {
+                    throw std::runtime_error(std::format("can't create {}", sidecar_path.string()));
+                }
+            }
+
+            void Write(RecordedFrame const& frame) {
+                if (!writer_.isOpened()) {
+                    video_size_ = frame.annotated_image.size();
+                    writer_.open(video_path_.string(), fourcc_, fps_, video_size_);
+                    if (!writer_.isOpened()) {
+                        throw std::runtime_error(std::format("can't create {}", video_path_.string()));
+                    }
+                }
+                if (frame.annotated_image.size() == video_size_) {
+                    writer_.write(frame.annotated_image);
+                } else {
+                    // the writer silently ignores frames of another size
+                    cv::Mat resized;
+                    cv::resize(frame.annotated_image, resized, video_size_);
+                    writer_.write(resized);
+                }
+
+                sidecar_ << FormatSidecarLine(frame) << '\n';
+            }
+
+        private:
+            std::filesystem::path const video_path_;
+            int const fourcc_;
+            double const fps_;
+            cv::VideoWriter writer_;
+            cv::Size video_size_;
+            std::ofstream sidecar_;
+        };
+    }
+
+    auto FormatSidecarLine(RecordedFrame const& frame) -> std::string {
+        auto line = std::format(R"({{"frame":{},"captured_at_s":{},"latency_ms":{},"reused":{},"quality_level":{},"bananas":[)",
+                                frame.frame_number, FormatNumber(frame.captured_at_s, 6), FormatNumber(frame.latency_ms, 3),
+                                frame.is_reused, static_cast<int>(frame.quality_level));
+        for (std::size_t i = 0; i < frame.bananas.size(); ++i) {
+            auto const& banana = frame.bananas[i];
+            line += std::format(R"({}{{"center":[{},{}],"rotation_angle":{},"mean_curvature":{},"length":{},"ripeness":{},"ripeness_uncertainty":{}}})",
+                                i == 0 ? "" : ",", banana.estimated_center.x, banana.estimated_center.y,
+                                FormatNumber(banana.rotation_angle, 6), FormatNumber(banana.mean_curvature, 6),
+                                FormatNumber(banana.length, 6), FormatNumber(banana.ripeness, 4), FormatNumber(banana.ripeness_uncertainty, 4));
+        }
+        line += "]}";
+        return line;
+    }
+
+    VideoRecorder::VideoRecorder(std::filesystem::path video_path, std::filesystem::path const& sidecar_path, double const fps, std::size_t const queue_capacity)
+            : VideoRecorder([writer = std::make_shared<FileWriter>(std::move(video_path), sidecar_path, fps)](RecordedFrame const& frame) {
+                writer->Write(frame);
+            }, queue_capacity) {
+    }
+
+    VideoRecorder::VideoRecorder(WriteFunction write_function, std::size_t const queue_capacity)
+            : write_function_(std::move(write_function)), queue_capacity_(queue_capacity), started_at_(Clock::now()) {
+        encoder_ = std::jthread{[this](std::stop_token const& stop_token) { this->EncoderLoop(stop_token); }};
+    }
+
+    VideoRecorder::~VideoRecorder() {
+        // the encoder finishes the queue before it stops
+        encoder_.request_stop();
+        encoder_.join();
+    }
+
+    auto VideoRecorder::Submit(SourceResult const& result) -> bool {
+        if (!result.analysis.result) {
+            return false;
+        }
+
+        {
+            std::scoped_lock const lock{mutex_};
+            if (queue_.size() >= queue_capacity_) {
+                ++dropped_frames_;
+                return false;
+            }
+
+            // only the few values needed for the sidecar are copied, the image is shared
+            auto const& analysis_result = *result.analysis.result;
+            std::vector<RecordedFrame::Banana> bananas;
+            bananas.reserve(analysis_result.banana.size());
+            for (auto const& banana : analysis_result.banana) {
+                bananas.push_back({
+                    .estimated_center = banana.estimated_center,
+                    .rotation_angle = banana.rotation_angle,
+                    .mean_curvature = banana.mean_curvature,
+                    .length = banana.length,
+                    .ripeness = banana.ripeness,
+                    .ripeness_uncertainty = banana.ripeness_uncertainty,
+                });
+            }
+            queue_.push_back({
+                .frame_number = result.frame_number,
+                .captured_at_s = std::chrono::duration<double>(result.captured_at - started_at_).count(),
+                .latency_ms = std::chrono::duration<double, std::milli>(result.latency).count(),
+                .is_reused = result.analysis.is_reused,
+                .quality_level = result.analysis.quality_level,
+                .annotated_image = analysis_result.annotated_image,
+                .bananas = std::move(bananas),
+            });
+        }
+        frame_queued_.notify_one();
+        return true;
+    }
+
+    auto VideoRecorder::GetStats() const -> RecorderStats {
+        std::scoped_lock const lock{mutex_};
+        return {
+            .recorded_frames = recorded_frames_,
+            .dropped_frames = dropped_frames_,
+            .queued_frames = queue_.size(),
+        };
+    }
+
+    void VideoRecorder::EncoderLoop(std::stop_token const& stop_token) {
+        std::unique_lock lock{mutex_};
+        while (true) {
+            frame_queued_.wait(lock, stop_token, [this] { return !queue_.empty(); });
+            if (queue_.empty()) {
+                return; // stop has been requested and everything has been written
+            }
+
+            auto frame = std::move(queue_.front());
+            queue_.pop_front();
+
+            // encoding is slow, the capture and analysis must not wait for it
+            lock.unlock();
+            auto is_written = false;
+            if (!has_failed_) {
+                try {
+                    write_function_(frame);
+                    is_written = true;
+                } catch (std::exception const& ex) {
+                    // keep the application running, the frames are counted as dropped from now on
+                    std::cerr << "recording failed: " << ex.what() << std::endl;
+                    has_failed_ = true;
+                }
+            }
+            lock.lock();
+
+            if (is_written) {
+                ++recorded_frames_;
+            } else {
+                ++dropped_frames_;
+            }
+        }
+    }
+
+}
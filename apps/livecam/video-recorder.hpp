@@ -0,0 +1,138 @@
+#ifndef BANANA_PROJECT_VIDEO_RECORDER_HPP
+#define BANANA_PROJECT_VIDEO_RECORDER_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include "analysis-pool.hpp"
+
+namespace livecam {
+
+    /// Statistics of a `VideoRecorder`.
+    struct RecorderStats {
+        /// Number of frames which have been written to the video.
+        std::size_t recorded_frames;
+
+        /// Number of frames which have been dropped because the encoder couldn't keep up.
+        std::size_t dropped_frames;
+
+        /// Number of frames currently waiting for the encoder.
+        std::size_t queued_frames;
+    };
+
+    /// A frame with the results which are recorded for it.
+    struct RecordedFrame {
+        /// The data of a banana which is written to the sidecar.
+        struct Banana {
+            cv::Point estimated_center;
+            double rotation_angle;
+            double mean_curvature;
+            double length;
+            float ripeness;
+            float ripeness_uncertainty;
+        };
+
+        std::size_t frame_number;
+        /// When the frame has been captured, in seconds since the recorder has been created.
+        double captured_at_s;
+        double latency_ms;
+        bool is_reused;
+        QualityLevel quality_level;
+        cv::Mat annotated_image;
+        std::vector<Banana> bananas;
+    };
+
+    /**
+     * Format the results of a frame as a line of the sidecar file: a JSON object (without the line break) with the keys
+     * `frame`, `captured_at_s`, `latency_ms`, `reused`, `quality_level` and `bananas`, the latter being a list of objects
+     * with the keys `center` (`[x, y]`), `rotation_angle`, `mean_curvature`, `length`, `ripeness` and
+     * `ripeness_uncertainty`. Values which aren't finite are written as `null`.
+     */
+    [[nodiscard]]
+    auto FormatSidecarLine(RecordedFrame const& frame) -> std::string;
+
+    /// Function called by the encoder thread of a `VideoRecorder` to write a frame. An exception stops the recording.
+    typedef std::function<void(RecordedFrame const& frame)> WriteFunction;
+
+    /**
+     * Records the annotated frames of a source to a video file and the results of each frame to a sidecar file
+     * (JSON Lines, one object per frame, see `FormatSidecarLine`), or passes them to a custom `WriteFunction`.
+     *
+     * The frames are encoded by a dedicated thread, thus submitting a frame never waits for the encoder. If the encoder
+     * falls behind the queue fills up and further frames are dropped (and counted) until there is space again, thus the
+     * analysis is never slowed down by the recording. Dropped frames are missing from both the video and the sidecar.
+     */
+    class VideoRecorder {
+    public:
+        /**
+         * Start the encoder thread. The files are created once the first frame arrives, as the video needs its size.
+         *
+         * @param video_path path of the video file, the codec is derived from the extension: Motion JPEG for ".avi" and
+         *                   ".mkv", MPEG-4 for ".mp4".
+         * @param sidecar_path path of the file receiving the results.
+         * @param fps frame rate stored in the video.
+         * @param queue_capacity maximum number of frames waiting for the encoder.
+         * @throws std::invalid_argument if the extension of the video is none of the above.
+         * @throws std::runtime_error if the sidecar file can't be created.
+         */
+        VideoRecorder(std::filesystem::path video_path, std::filesystem::path const& sidecar_path, double fps, std::size_t queue_capacity);
+
+        /**
+         * Start the encoder thread, which passes the frames to a custom function instead of writing them to files.
+         *
+         * @param write_function the function writing a frame, it's allowed to be slow.
+         * @param queue_capacity maximum number of frames waiting for the encoder.
+         */
+        VideoRecorder(WriteFunction write_function, std::size_t queue_capacity);
+
+        VideoRecorder(VideoRecorder const&) = delete;
+        auto operator=(VideoRecorder const&) -> VideoRecorder& = delete;
+
+        /// Writes all frames which are still queued before returning.
+        ~VideoRecorder();
+
+        /**
+         * Queue the annotated frame and the results of a successful analysis for recording. The image is not copied, it
+         * must not be modified anymore by the caller.
+         *
+         * @return `false` if the frame has been dropped because the queue is full.
+         */
+        auto Submit(SourceResult const& result) -> bool;
+
+        [[nodiscard]]
+        auto GetStats() const -> RecorderStats;
+
+    private:
+        void EncoderLoop(std::stop_token const& stop_token);
+
+        WriteFunction const write_function_;
+        std::size_t const queue_capacity_;
+        /// Reference for the timestamps in the sidecar.
+        Clock::time_point const started_at_;
+
+        /// Set if writing a frame failed, nothing is written anymore afterwards. Only used by the encoder thread.
+        bool has_failed_{false};
+
+        mutable std::mutex mutex_;
+        std::condition_variable_any frame_queued_;
+        std::deque<RecordedFrame> queue_;
+        std::size_t recorded_frames_{0};
+        std::size_t dropped_frames_{0};
+
+        /// Must be the last member so that the encoder is stopped before anything it uses is destroyed.
+        std::jthread encoder_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_VIDEO_RECORDER_HPP
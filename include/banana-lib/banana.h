@@ -0,0 +1,180 @@
+/**\file
+ * \brief C API of the banana library, for embedding it in other languages and runtimes.
+ *
+ * The images are passed as raw pixel buffers owned by the caller (no copy is made for BGR images) and the results are
+ * written to buffers provided by the caller, thus no memory is allocated across the API boundary.
+ *
+ * An analyzer handle can be used by multiple threads at the same time.
+ */
+
+#ifndef BANANA_PROJECT_BANANA_H
+#define BANANA_PROJECT_BANANA_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(BANANA_C_API_EXPORTS)
+#    define BANANA_C_API __declspec(dllexport)
+#  else
+#    define BANANA_C_API __declspec(dllimport)
+#  endif
+#else
+#  define BANANA_C_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Version of the API, incremented whenever the layout of a struct or the signature of a function changes. */
+#define BANANA_C_API_VERSION 2
+
+typedef enum banana_status {
+    BANANA_STATUS_OK = 0,
+    /** An argument is invalid (e.g. a null pointer or an unsupported pixel format). */
+    BANANA_STATUS_INVALID_ARGUMENT = 1,
+    /** The image is invalid (e.g. empty), see `banana::AnalysisError::kInvalidImage`. */
+    BANANA_STATUS_INVALID_IMAGE = 2,
+    /** The center line of a banana couldn't be calculated, see `banana::AnalysisError::kPolynomialCalcFailure`. */
+    BANANA_STATUS_POLYNOMIAL_CALC_FAILURE = 3,
+    /** The analysis succeeded but not all results fit into the buffers provided by the caller. */
+    BANANA_STATUS_BUFFER_TOO_SMALL = 4,
+    /** Any other error, see `banana_get_last_error_message`. */
+    BANANA_STATUS_INTERNAL_ERROR = 5,
+} banana_status_t;
+
+/** Layout of the pixels, 8 bits per channel. */
+typedef enum banana_pixel_format {
+    /** Used as-is, without any copy. */
+    BANANA_PIXEL_FORMAT_BGR8 = 0,
+    /** Converted to BGR in a buffer which is reused by the calling thread. */
+    BANANA_PIXEL_FORMAT_RGB8 = 1,
+    /** Converted to BGR in a buffer which is reused by the calling thread. */
+    BANANA_PIXEL_FORMAT_BGRA8 = 2,
+    /** Converted to BGR in a buffer which is reused by the calling thread. */
+    BANANA_PIXEL_FORMAT_RGBA8 = 3,
+} banana_pixel_format_t;
+
+/** Pixel buffer owned by the caller. It is only read during the call which it is passed to. */
+typedef struct banana_image {
+    /** The first pixel of the first row. */
+    void const* data;
+    int32_t width;
+    int32_t height;
+    /** Distance between the start of two rows (in bytes). Must be at least `width` times the size of a pixel. */
+    size_t stride;
+    banana_pixel_format_t format;
+} banana_image_t;
+
+typedef struct banana_point {
+    int32_t x;
+    int32_t y;
+} banana_point_t;
+
+typedef struct banana_rect {
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+} banana_rect_t;
+
+/** A region of the image in which bananas are searched, see `banana::InspectionZone`. */
+typedef struct banana_inspection_zone {
+    int32_t id;
+    /** The corners of the polygon, at least 3. */
+    banana_point_t const* points;
+    size_t num_points;
+} banana_inspection_zone_t;
+
+/** Settings of an analyzer, see `banana::Analyzer::Settings` for their meaning. Initialise them with `banana_settings_init`. */
+typedef struct banana_settings {
+    float match_max_score;
+    float min_area;
+    float max_area;
+    /** Has no default and must be set. */
+    double pixels_per_meter;
+    int32_t detection_band_height;
+    size_t ripeness_sample_budget;
+    float ripeness_max_uncertainty;
+    /** 0 = false, everything else = true. */
+    int32_t bit_packed_detection_mask;
+    /** May be null if `num_inspection_zones` is 0 (the default), the whole image is then inspected. Copied by `banana_analyzer_create`. */
+    banana_inspection_zone_t const* inspection_zones;
+    size_t num_inspection_zones;
+} banana_settings_t;
+
+/** The analysis results for a banana, see `banana::AnalysisResult` for the meaning of the fields. */
+typedef struct banana_result {
+    /** Bounding box of the contour. */
+    banana_rect_t bounding_box;
+    banana_point_t estimated_center;
+    double rotation_angle;
+    /** The coefficients a0, a1 and a2 of the center line. */
+    double center_line_coefficients[3];
+    double mean_curvature;
+    double length;
+    float ripeness;
+    float ripeness_uncertainty;
+    /** Index of the first point of the contour in `banana_output_t::contour_points`. */
+    size_t contour_offset;
+    /** Number of points of the contour. */
+    size_t contour_size;
+    /** ID of the inspection zone in which the banana has been found, -1 if no zones are set. */
+    int32_t zone_id;
+} banana_result_t;
+
+/** Buffers provided by the caller to receive the results of an analysis. */
+typedef struct banana_output {
+    /** Receives the results, may be null if `results_capacity` is 0. */
+    banana_result_t* results;
+    size_t results_capacity;
+    /** Set to the number of bananas found (even if this is larger than `results_capacity`). */
+    size_t num_results;
+
+    /** Receives the points of the contours, may be null if the contours aren't needed. */
+    banana_point_t* contour_points;
+    size_t contour_points_capacity;
+    /** Set to the total number of points of all contours (even if this is larger than `contour_points_capacity`). */
+    size_t num_contour_points;
+} banana_output_t;
+
+/** Opaque handle of an analyzer. */
+typedef struct banana_analyzer banana_analyzer_t;
+
+/** The version of the API implemented by the library, compare it with `BANANA_C_API_VERSION`. */
+BANANA_C_API int32_t banana_get_api_version(void);
+
+/** Fill the settings with the defaults. */
+BANANA_C_API void banana_settings_init(banana_settings_t* settings);
+
+/**
+ * Create an analyzer. Release it with `banana_analyzer_destroy`.
+ *
+ * @param settings the settings of the analyzer, they are copied.
+ * @param analyzer receives the handle of the analyzer.
+ */
+BANANA_C_API banana_status_t banana_analyzer_create(banana_settings_t const* settings, banana_analyzer_t** analyzer);
+
+/** Release an analyzer. No other thread may use it anymore. Passing null is allowed. */
+BANANA_C_API void banana_analyzer_destroy(banana_analyzer_t* analyzer);
+
+/**
+ * Analyse an image for the presence of bananas and their properties. May be called concurrently with the same analyzer.
+ *
+ * The results of the bananas are written to `output->results` as long as there is space for them, their contours are
+ * written to `output->contour_points` if it is provided and as long as they fit completely.
+ *
+ * @return `BANANA_STATUS_BUFFER_TOO_SMALL` if not all results or contours fit into the buffers. `num_results` and
+ * `num_contour_points` tell how large the buffers need to be.
+ */
+BANANA_C_API banana_status_t banana_analyze(banana_analyzer_t const* analyzer, banana_image_t const* image, banana_output_t* output);
+
+/** Message describing the last error which occurred on the calling thread. Valid until the next call on this thread. */
+BANANA_C_API char const* banana_get_last_error_message(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //BANANA_PROJECT_BANANA_H
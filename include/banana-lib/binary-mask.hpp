@@ -0,0 +1,111 @@
+#ifndef BANANA_PROJECT_BINARY_MASK_HPP
+#define BANANA_PROJECT_BINARY_MASK_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace banana {
+
+    /**
+     * Binary image with one bit per pixel, packed into 64 bit words (least significant bit first). Each row starts at a
+     * new word, the unused bits at the end of a row are always 0.
+     *
+     * The operations on the mask process 64 pixels per word operation, which makes them much cheaper than the same
+     * operations on an 8 bit mask (one byte per pixel). They produce exactly the same results as the corresponding
+     * OpenCV functions on a 0/255 mask.
+     */
+    class BinaryMask {
+    public:
+        /// Create an empty (all black) mask.
+        BinaryMask(int rows, int cols);
+
+        /**
+         * Pack an 8 bit mask.
+         *
+         * @param mask single channel 8 bit image, all non-zero pixels are set.
+         */
+        [[nodiscard]]
+        static auto FromMat(cv::Mat const& mask) -> BinaryMask;
+
+        /// Unpack the mask to a single channel 8 bit image, set pixels are 255, the others 0.
+        [[nodiscard]]
+        auto ToMat() const -> cv::Mat;
+
+        [[nodiscard]]
+        auto Rows() const -> int;
+
+        [[nodiscard]]
+        auto Cols() const -> int;
+
+        [[nodiscard]]
+        auto Row(int y) -> std::span<std::uint64_t>;
+
+        [[nodiscard]]
+        auto Row(int y) const -> std::span<std::uint64_t const>;
+
+        /**
+         * Erode the mask with a square kernel. Pixels outside of the mask are treated as set.
+         *
+         * @see cv::erode with a `cv::MORPH_RECT` kernel and the default border.
+         */
+        [[nodiscard]]
+        auto Erode(int kernel_size) const -> BinaryMask;
+
+        /**
+         * Dilate the mask with a square kernel. Pixels outside of the mask are treated as not set.
+         *
+         * @see cv::dilate with a `cv::MORPH_RECT` kernel and the default border.
+         */
+        [[nodiscard]]
+        auto Dilate(int kernel_size) const -> BinaryMask;
+
+        /**
+         * Morphological opening (erosion followed by dilation) with a square kernel.
+         *
+         * @see cv::morphologyEx with `cv::MORPH_OPEN` and a `cv::MORPH_RECT` kernel.
+         */
+        [[nodiscard]]
+        auto Open(int kernel_size) const -> BinaryMask;
+
+        /**
+         * Set each pixel to the majority value in the square window around it, the pixels at the border are replicated.
+         * On a binary image this is the same as the median.
+         *
+         * The number of set pixels in the window is kept in running counts per column and per window which are only
+         * updated where the mask changes from one row to the next, thus the cost mostly depends on the length of the
+         * edges in the mask rather than on the kernel size.
+         *
+         * @param kernel_size the size of the window, must be odd.
+         * @see cv::medianBlur
+         */
+        [[nodiscard]]
+        auto MajorityFilter(int kernel_size) const -> BinaryMask;
+
+    private:
+        /**
+         * Get the row shifted by `offset` pixels, i.e. pixel `x` of the result is pixel `x + offset` of the row.
+         * Pixels outside of the row are set to `border`.
+         */
+        void ShiftRow(int y, int offset, bool border, std::span<std::uint64_t> result) const;
+
+        /// Combine the shifted rows within the kernel, either with AND (erode) or OR (dilate).
+        [[nodiscard]]
+        auto ApplyRectKernel(int kernel_size, bool is_erosion) const -> BinaryMask;
+
+        /// Mask of the bits in the last word of each row which belong to the image.
+        [[nodiscard]]
+        auto LastWordMask() const -> std::uint64_t;
+
+        int rows_;
+        int cols_;
+        std::size_t words_per_row_;
+        std::vector<std::uint64_t> words_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_BINARY_MASK_HPP
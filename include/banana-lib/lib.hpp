@@ -1,9 +1,11 @@
 #ifndef BANANA_PROJECT_LIB_HPP
 #define BANANA_PROJECT_LIB_HPP
 
+#include <cstdint>
 #include <expected>
 #include <iostream>
 #include <list>
+#include <optional>
 #include <utility>
 #include <vector>
 
@@ -50,6 +52,15 @@ namespace banana {
         Value value;
     };
 
+    /// A region of the image in which bananas may appear (e.g. a lane of a conveyor belt), see `Analyzer::Settings::inspection_zones`.
+    struct InspectionZone {
+        /// Identifies the zone in the results, see `AnalysisResult::zone_id`.
+        int id;
+
+        /// Outline of the zone in the image, at least three points.
+        Contour polygon;
+    };
+
     /**
      * The analysis results for a banana which has been found in the image.
      */
@@ -93,8 +104,48 @@ namespace banana {
          * * > 100%: over-ripe
          */
         float ripeness;
+
+        /**
+         * Half-width of the 95% confidence interval of `ripeness` if it has been estimated from a sample of the pixels.
+         * 0 if every pixel of the banana has been classified.
+         *
+         * @see Analyzer::Settings::ripeness_sample_budget
+         */
+        float ripeness_uncertainty{0};
+
+        /// The ID of the inspection zone in which the banana has been found. Empty if no zones have been configured.
+        std::optional<int> zone_id{};
+    };
+
+    /// The ripeness of a banana, see `AnalysisResult::ripeness` and `AnalysisResult::ripeness_uncertainty`.
+    struct RipenessEstimate {
+        float ripeness;
+        float uncertainty;
+    };
+
+    /**
+     * The shape of a banana as found by the detection stage of the analysis, i.e. the part of the analysis which only
+     * depends on the image and the detection settings (but not e.g. on the calibration or the ripeness colours).
+     */
+    struct BananaShape {
+        /// Contour of the banana in the image.
+        Contour contour;
+
+        /// The rotation angle of the banana, as seen from the x-axis. Given in radians.
+        double rotation_angle;
+
+        /// The estimated center of the banana shape.
+        cv::Point estimated_center;
+
+        /// The coefficients of the center line, see `AnalysisResult::CenterLine::coefficients`.
+        Polynomial2DCoefficients center_line_coefficients;
+
+        /// See `AnalysisResult::zone_id`.
+        std::optional<int> zone_id{};
     };
 
+    class StageCache;
+
     /**
      * The analysis results as well as an image annotated with them which can be used for visualisation.
      */
@@ -147,6 +198,39 @@ namespace banana {
             /// Color threshold used to filter the incoming colors on the analyzed image.
             cv::Scalar const filter_lower_threshold_color{0, 41, 0};
             cv::Scalar const filter_upper_threshold_color{177, 255, 255};
+
+            /**
+             * Height (in px) of the horizontal bands in which the bananas are detected on large images.
+             * The bands are processed in parallel and each only needs working memory for its own band instead of several
+             * full-size temporaries. Bananas crossing the borders of the bands are stitched together again.
+             * If set to 0 (the default) or if the image is not higher than this, the image is processed in one go.
+             */
+            int const detection_band_height{0};
+
+            /**
+             * Number of positions sampled (stratified over the bounding box of a banana) to estimate its ripeness.
+             * This makes the cost of the ripeness independent of the image resolution.
+             * If set to 0 (the default) every pixel of the banana is classified.
+             */
+            std::size_t const ripeness_sample_budget{0};
+
+            /// Maximum accepted half-width of the 95% confidence interval of a sampled ripeness. If the estimate is less certain, every pixel of the banana is classified instead.
+            float const ripeness_max_uncertainty{0.05f};
+
+            /**
+             * Whether the noise removal and smoothing of the detection mask run on a bit-packed mask (see `BinaryMask`)
+             * instead of the OpenCV functions on an 8 bit mask. The results are identical, this only changes the speed.
+             */
+            bool const bit_packed_detection_mask{false};
+
+            /**
+             * The regions of the image in which bananas are searched. Each zone is processed on its own (in parallel),
+             * cropped to its bounding box, thus the pixels outside of all zones are never looked at. Only bananas lying
+             * within the polygon of a zone are found and they're tagged with its ID; a banana in the overlap of two
+             * zones is found in both of them. `detection_band_height` is not used for the zones.
+             * If empty (the default) the whole image is processed.
+             */
+            std::vector<InspectionZone> const inspection_zones{};
         };
 
         explicit Analyzer(Settings settings);
@@ -160,6 +244,21 @@ namespace banana {
         [[nodiscard]]
         auto AnalyzeImage(cv::Mat const& image) const -> std::expected<std::list<AnalysisResult>, AnalysisError>;
 
+        /**
+         * Analyse an image for the presence of bananas and their properties, re-using the intermediate results of a
+         * previous analysis of the same image if they're still valid for the current settings.
+         *
+         * The shapes of the bananas are re-used as long as the detection settings didn't change, the ripeness as long as
+         * the detection and ripeness settings didn't change. Everything else (e.g. sizes depending on `pixels_per_meter`)
+         * is cheap and always calculated again. The results are identical to the ones of `AnalyzeImage(image)`.
+         *
+         * @param image an image possibly containing bananas
+         * @param cache the cache in which the intermediate results are looked up and stored.
+         * @return the analysis results for each banana which has been found. If no banana has been found this list is empty.
+         */
+        [[nodiscard]]
+        auto AnalyzeImage(cv::Mat const& image, StageCache const& cache) const -> std::expected<std::list<AnalysisResult>, AnalysisError>;
+
         /**
          * Analyse an image for the presence of bananas and their properties.
          *
@@ -169,6 +268,51 @@ namespace banana {
         [[nodiscard]]
         auto AnalyzeAndAnnotateImage(cv::Mat const& image) const -> std::expected<AnnotatedAnalysisResult, AnalysisError>;
 
+        /**
+         * Annotate an image with the result from a previous analysis (the analysis must come from the same image or one showing the same scene).
+         * This is meant for visualisation to users and is not guaranteed to produce stable results.
+         *
+         * @param image a previously analysed image
+         * @param analysis_result the result of the previous analysis (done using AnalyzeImage).
+         * @return a copy of the original image with annotations.
+         * @see AnalyzeImage
+         */
+        [[nodiscard]]
+        auto AnnotateImage(cv::Mat const& image, std::list<AnalysisResult> const& analysis_result) const -> cv::Mat;
+
+        /**
+         * Checks whether the passed contour is - with a good likelihood - a banana.
+         * @param contour the contour which may or may not be a banana
+         * @return whether it is a banana
+         */
+        [[nodiscard]]
+        auto IsBananaContour(Contour const& contour) const -> bool;
+
+        /**
+         * Find the external contours of the objects in a detection mask which might be bananas based on their size.
+         *
+         * The objects are found as connected components first, those which are too small to be a banana are rejected
+         * before tracing their contour and the others are only traced within their bounding box. The contours are
+         * identical to the ones `cv::findContours` finds on the whole mask (minus the rejected ones).
+         *
+         * @param detection_mask the binary mask in which the bananas are being searched.
+         * @return the external contours of the candidates. these still need to be checked with `IsBananaContour`.
+         */
+        [[nodiscard]]
+        auto FindCandidateContours(cv::Mat const& detection_mask) const -> Contours;
+
+        /**
+         * Analyse the shape of a banana for which the contour and the ripeness have already been determined.
+         * This is used by specialised analyzers which only replace parts of the analysis.
+         *
+         * @param banana_contour the contour of the banana to be analysed
+         * @param ripeness the ripeness of the banana, see `AnalysisResult::ripeness`.
+         * @return the analysis result for the banana.
+         * @see StaticAnalyzer
+         */
+        [[nodiscard]]
+        auto AnalyzeBananaContour(Contour const& banana_contour, float ripeness) const -> std::expected<AnalysisResult, AnalysisError>;
+
     private:
         /// Internal structure to store the results of `GetPCA` for further processing in a convenient way.
         struct PCAResult {
@@ -178,12 +322,21 @@ namespace banana {
             double angle;
         };
 
+        /// The x ranges (half-open) covered by a contour per row of its bounding box, see `GetContourRowSpans`.
+        typedef std::vector<std::vector<cv::Range>> RowSpans;
+
         /// All externally configurable settings used by the analyzer.
         Settings const settings_;
 
         /// Reference contour for the banana, used in filtering.
         Contour reference_contour_;
 
+        /// Hash of everything the detection stage depends on, used as part of the key for the `StageCache`.
+        std::uint64_t detection_settings_hash_;
+
+        /// Hash of everything the ripeness stage depends on (incl. the detection stage), used as part of the key for the `StageCache`.
+        std::uint64_t ripeness_settings_hash_;
+
         /**
          * filters the image for banana-related colors and returns a corresponding binary image.
          *
@@ -196,12 +349,39 @@ namespace banana {
         auto ColorFilter(cv::Mat const& image, cv::Scalar low, cv::Scalar up) const -> cv::Mat;
 
         /**
-         * Checks whether the passed contour is - with a good likelihood - a banana.
-         * @param contour the contour which may or may not be a banana
-         * @return whether it is a banana
+         * Create the binary mask of the image in which the bananas are being searched.
+         *
+         * @param image the image containing bananas.
+         * @return binary image, which colours all pixels which might belong to a banana white, otherwise black
          */
         [[nodiscard]]
-        auto IsBananaContour(Contour const& contour) const -> bool;
+        auto CreateDetectionMask(cv::Mat const& image) const -> cv::Mat;
+
+        /**
+         * Create the binary mask for a region of the image in which the bananas are being searched.
+         * Only the region and a small margin around it are processed, yet the result is identical to the same region
+         * of the mask for the whole image.
+         *
+         * @param image the image containing bananas.
+         * @param region the region of the image for which the mask should be created.
+         * @return binary mask with the size of the region.
+         * @see CreateDetectionMask
+         */
+        [[nodiscard]]
+        auto CreateDetectionMask(cv::Mat const& image, cv::Rect const& region) const -> cv::Mat;
+
+        /**
+         * Find the external contours of all objects in the detection mask, processing the image in horizontal bands.
+         * The parts of objects crossing the borders of the bands are kept as runs (see `RunLengthMask`), joined with their
+         * parts in the neighbouring bands and traced as a whole. No mask larger than a band is created, and the contours
+         * are identical to the ones found on the mask of the whole image (albeit possibly in a different order).
+         *
+         * @param image the image containing bananas.
+         * @return the external contours of all objects (not yet filtered for bananas).
+         * @see Settings::detection_band_height
+         */
+        [[nodiscard]]
+        auto FindContoursInBands(cv::Mat const& image) const -> Contours;
 
         /**
          * Identify all bananas present in an image and return their contours.
@@ -212,6 +392,33 @@ namespace banana {
         [[nodiscard]]
         auto FindBananaContours(cv::Mat const& image) const -> Contours;
 
+        /**
+         * Identify all bananas lying within an inspection zone and return their contours.
+         * Only the bounding box of the zone is processed.
+         *
+         * @param image the image containing bananas.
+         * @param zone the zone in which the bananas are searched.
+         * @return a list of the contours (in image coordinates) of all identified bananas. may be empty if no bananas have been found.
+         */
+        [[nodiscard]]
+        auto FindBananaContoursInZone(cv::Mat const& image, InspectionZone const& zone) const -> Contours;
+
+        /// The contours of the bananas found in an inspection zone, or in the whole image if there are no zones.
+        struct ZoneContours {
+            std::optional<int> zone_id;
+            Contours contours;
+        };
+
+        /**
+         * Identify all bananas in the inspection zones (or in the whole image if there are no zones).
+         *
+         * @param image the image containing bananas.
+         * @return the contours of the identified bananas, per zone (in the order of the settings).
+         * @see Settings::inspection_zones
+         */
+        [[nodiscard]]
+        auto FindBananaContoursByZone(cv::Mat const& image) const -> std::vector<ZoneContours>;
+
         /**
          * Calculate the coefficients of the two-dimensional polynomial describing the center line.
          * Important: note that this is given along the primary axis of the banana and not in relation to the x-axis of the image.
@@ -277,7 +484,7 @@ namespace banana {
          * Extract the masked part of an image for the defined contour.
          * @param image the image from which the masked part should be extracted.
          * @param contour the contour defining the mask.
-         * @return the masked image. all parts outside of the mask will be black.
+         * @return the masked image, cropped to the bounding rectangle of the contour. all parts outside of the mask will be white.
          */
         [[nodiscard]]
         auto GetMaskedImage(cv::Mat const& image, Contour const& contour) const -> cv::Mat;
@@ -293,6 +500,58 @@ namespace banana {
         [[nodiscard]]
         auto IdentifyBananaRipeness(cv::Mat const& banana_image) const -> float;
 
+        /**
+         * Determine which pixels are covered by a contour (incl. its border), row by row. Needs O(points + rows) time,
+         * after which a pixel can be tested without looking at the whole contour again (unlike `cv::pointPolygonTest`).
+         *
+         * @param contour the contour.
+         * @param bounds the bounding rectangle of the contour.
+         * @return the spans of each row of the bounding rectangle, starting with the row at `bounds.y`.
+         */
+        [[nodiscard]]
+        auto GetContourRowSpans(Contour const& contour, cv::Rect const& bounds) const -> RowSpans;
+
+        /**
+         * Estimate the ripeness of the banana from a stratified sample of its pixels.
+         *
+         * @param image the image containing the banana.
+         * @param banana_contour the contour of the banana.
+         * @return the estimated ripeness or nothing if the sample doesn't contain any classifiable pixels.
+         * @see Settings::ripeness_sample_budget
+         */
+        [[nodiscard]]
+        auto SampleBananaRipeness(cv::Mat const& image, Contour const& banana_contour) const -> std::optional<RipenessEstimate>;
+
+        /**
+         * Determine the ripeness of the banana, either by sampling its pixels (if enabled and precise enough) or by
+         * classifying all of its pixels.
+         *
+         * @param image the image containing the banana.
+         * @param banana_contour the contour of the banana.
+         * @return the ripeness of the banana.
+         */
+        [[nodiscard]]
+        auto GetBananaRipeness(cv::Mat const& image, Contour const& banana_contour) const -> RipenessEstimate;
+
+        /**
+         * Determine the shape of the banana: its position, rotation and center line.
+         *
+         * @param banana_contour the contour of the banana to be analysed
+         * @return the shape of the banana.
+         */
+        [[nodiscard]]
+        auto GetBananaShape(Contour const& banana_contour) const -> std::expected<BananaShape, AnalysisError>;
+
+        /**
+         * Calculate all remaining properties of a banana of which the shape and ripeness are already known.
+         *
+         * @param shape the shape of the banana.
+         * @param ripeness the ripeness of the banana.
+         * @return the analysis result for the banana.
+         */
+        [[nodiscard]]
+        auto CompleteBananaAnalysis(BananaShape const& shape, RipenessEstimate const& ripeness) const -> AnalysisResult;
+
         /**
          * Analyse the banana.
          *
@@ -320,18 +579,6 @@ namespace banana {
          */
         void PlotPCAResult(cv::Mat& draw_target, AnalysisResult const& result) const;
 
-        /**
-         * Annotate an image with the result from a previous analysis (the analysis must come from the same image).
-         * This is meant for visualisation to users and is not guaranteed to produce stable results.
-         *
-         * @param image a previously analysed image
-         * @param analysis_result the result of the previous analysis (done using AnalyzeImage).
-         * @return a copy of the original image with annotations.
-         * @see AnalyzeImage
-         */
-        [[nodiscard]]
-        auto AnnotateImage(cv::Mat const& image, std::list<AnalysisResult> const& analysis_result) const -> cv::Mat;
-
     };
 
 }
@@ -0,0 +1,176 @@
+#ifndef BANANA_PROJECT_METRICS_AGGREGATOR_HPP
+#define BANANA_PROJECT_METRICS_AGGREGATOR_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <vector>
+
+#include <banana-lib/lib.hpp>
+
+namespace banana {
+
+    /// Range of the values covered by a histogram of the `MetricsAggregator`.
+    struct HistogramRange {
+        double lower;
+        double upper;
+    };
+
+    /// Distribution of a metric of the bananas within the window of a `MetricsAggregator`.
+    struct MetricSummary {
+        /// Number of values.
+        std::uint64_t count;
+
+        /// Number of values which have been ignored because they weren't finite (e.g. NaN), these aren't part of `count`.
+        std::uint64_t non_finite_count;
+
+        /// Mean of the values. NaN if there are none.
+        double mean;
+
+        /// Sample variance of the values. NaN if there are less than two.
+        double variance;
+
+        /// The range covered by the histogram.
+        HistogramRange range;
+
+        /// Number of values per bin, the bins split the range into equally wide parts. Values outside of the range are counted in the first / last bin.
+        std::vector<std::uint64_t> histogram;
+
+        /**
+         * Approximate quantile of the values, interpolated linearly within the bin of the histogram containing it.
+         * The error is thus at most the width of a bin (as long as the values lie within the range of the histogram).
+         *
+         * @param q the quantile, between 0 and 1 (e.g. 0.5 for the median).
+         * @return the approximate quantile, NaN if there are no values.
+         */
+        [[nodiscard]]
+        auto Quantile(double q) const -> double;
+    };
+
+    /// The aggregated metrics within the window of a `MetricsAggregator` at the time of the snapshot.
+    struct MetricsSnapshot {
+        /// Number of analysed frames.
+        std::uint64_t frames;
+
+        MetricSummary ripeness;
+
+        /// See `AnalysisResult::length` (in m).
+        MetricSummary length;
+
+        /// See `AnalysisResult::mean_curvature` (in 1/m).
+        MetricSummary mean_curvature;
+    };
+
+    /**
+     * Rolling aggregates (count, mean, variance and histogram for approximate quantiles) of the metrics of the bananas
+     * found in a stream of analysis results, e.g. for dashboards showing the distributions over the last minute or hour.
+     *
+     * The window is split into a fixed number of time buckets. Each bucket holds the aggregates of its period, which are
+     * merged when taking a snapshot. Once the window moved past a bucket it is reused for a new period, thus the memory
+     * needed is constant and the window moves in steps of one bucket.
+     *
+     * Results can be added from multiple threads at the same time without any locks, snapshots can be taken at any time
+     * and cost only the merging of the buckets. Each counter is exact (a bucket is only reused once all results of its
+     * old period have been added completely), but a snapshot taken while results are being added may contain a result in
+     * some counters but not yet in others.
+     */
+    class MetricsAggregator {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        /// Number of bins of the histograms.
+        static constexpr std::size_t kHistogramBins = 64;
+
+        struct Settings {
+            /// Duration of a bucket, i.e. the step in which the window moves.
+            Clock::duration const bucket_duration{std::chrono::seconds{1}};
+
+            /// Number of buckets, the window covers `num_buckets * bucket_duration`.
+            std::size_t const num_buckets{60};
+
+            HistogramRange const ripeness_range{0, 2};
+
+            /// In m.
+            HistogramRange const length_range{0, 0.5};
+
+            /// In 1/m.
+            HistogramRange const mean_curvature_range{0, 50};
+        };
+
+        explicit MetricsAggregator(Settings settings);
+
+        /**
+         * Add the results of an analysed frame. Can be called concurrently from multiple threads.
+         *
+         * @param results the results of all bananas found in the frame.
+         * @param timestamp when the frame has been captured. Results which are older than the window are ignored.
+         */
+        void AddFrame(std::list<AnalysisResult> const& results, Clock::time_point timestamp = Clock::now());
+
+        /**
+         * Aggregate the metrics of all results within the window.
+         *
+         * @param timestamp the end of the window.
+         */
+        [[nodiscard]]
+        auto Snapshot(Clock::time_point timestamp = Clock::now()) const -> MetricsSnapshot;
+
+    private:
+        /// Value of `Bucket::period` while a bucket is being cleared for a new period.
+        static constexpr std::int64_t kClearing = -1;
+        /// Value of `Bucket::period` of a bucket which hasn't been used yet.
+        static constexpr std::int64_t kUnused = -2;
+
+        struct MetricCounters {
+            std::atomic<std::uint64_t> count;
+            std::atomic<std::uint64_t> non_finite_count;
+            std::atomic<double> sum;
+            std::atomic<double> sum_of_squares;
+            std::array<std::atomic<std::uint64_t>, kHistogramBins> histogram;
+        };
+
+        struct Bucket {
+            /// Index of the period (timestamp / bucket_duration) which this bucket currently holds.
+            std::atomic<std::int64_t> period{kUnused};
+            /// Number of threads currently adding results to the bucket, it's only cleared for a new period once they're done.
+            std::atomic<std::uint32_t> writers{0};
+            std::atomic<std::uint64_t> frames;
+            MetricCounters ripeness;
+            MetricCounters length;
+            MetricCounters mean_curvature;
+        };
+
+        [[nodiscard]]
+        auto GetPeriod(Clock::time_point timestamp) const -> std::int64_t;
+
+        /**
+         * Get the bucket for a period, clearing it first if it still holds an older period. The bucket is pinned to the
+         * period (i.e. it can't be cleared) until it's released again with `ReleaseBucket`.
+         *
+         * @return the bucket or null if it already holds a newer period, i.e. the period is outside of the window.
+         */
+        [[nodiscard]]
+        auto AcquireBucket(std::int64_t period) -> Bucket*;
+
+        /// Unpin a bucket returned by `AcquireBucket` once all results have been added to it.
+        static void ReleaseBucket(Bucket& bucket);
+
+        /// Add a value to the counters of a metric. Values which aren't finite are only counted as such.
+        static void AddValue(MetricCounters& counters, HistogramRange const& range, double value);
+
+        /// Merge the counters of a metric from all buckets within the window.
+        [[nodiscard]]
+        static auto Summarize(std::vector<Bucket const*> const& buckets, MetricCounters Bucket::* metric, HistogramRange const& range) -> MetricSummary;
+
+        Settings const settings_;
+
+        std::unique_ptr<Bucket[]> buckets_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_METRICS_AGGREGATOR_HPP
@@ -0,0 +1,140 @@
+#ifndef BANANA_PROJECT_RESULT_BUS_HPP
+#define BANANA_PROJECT_RESULT_BUS_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <list>
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <banana-lib/lib.hpp>
+
+namespace banana {
+
+    /// The results of a banana as published on the `ResultBus`, see `AnalysisResult` for the meaning of the fields.
+    struct PublishedBanana {
+        /// Bounding box of the contour: x, y, width, height.
+        std::array<std::int32_t, 4> bounding_box;
+        std::array<std::int32_t, 2> estimated_center;
+        double rotation_angle;
+        double mean_curvature;
+        double length;
+        float ripeness;
+        float ripeness_uncertainty;
+        /// -1 if the banana hasn't been found in an inspection zone.
+        std::int32_t zone_id;
+    };
+
+    /// The results of an analysed frame as published on the `ResultBus`.
+    struct PublishedFrame {
+        /// Maximum number of bananas stored per frame. `num_bananas` tells if there were more.
+        static constexpr std::size_t kMaxBananas = 16;
+
+        /// Assigned by the bus when publishing: 0 for the first frame, incremented by one for each frame.
+        std::uint64_t sequence;
+
+        /// `std::chrono::steady_clock` time (in ns) at which the frame has been captured.
+        std::int64_t captured_at_ns;
+
+        /// Number of bananas found, only the first `kMaxBananas` of them are stored in `bananas`.
+        std::uint64_t num_bananas;
+        std::array<PublishedBanana, kMaxBananas> bananas;
+    };
+
+    static_assert(std::is_trivially_copyable_v<PublishedFrame> && sizeof(PublishedFrame) % sizeof(std::uint64_t) == 0,
+                  "the frames are copied in and out of the bus word by word");
+
+    /**
+     * Publishes the results of the analysed frames to any number of readers, e.g. a status page or a bridge to a PLC
+     * which want the most recent results without being part of the analysis loop.
+     *
+     * The frames are stored in a ring buffer with a fixed capacity, each slot is protected by a sequence lock: the single
+     * writer never waits for the readers and the readers never wait for each other. A reader which is overtaken by the
+     * writer while copying a frame simply tries again. Readers falling behind by more than the capacity miss frames,
+     * which they can tell from the sequence numbers (see `Subscriber`).
+     *
+     * `Publish` must only be called by one thread at a time, all other methods can be called by any thread.
+     */
+    class ResultBus {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        enum class ReadError {
+            /// The frame hasn't been published yet.
+            kNotYetPublished,
+            /// The frame has already been overwritten by a newer one.
+            kOverwritten,
+        };
+
+        /**
+         * Reads the frames of a bus in order, starting with the oldest frame still available when it's created.
+         * Each subscriber is only used by one thread, but there can be any number of them for the same bus.
+         */
+        class Subscriber {
+        public:
+            explicit Subscriber(ResultBus const& bus);
+
+            /// The next frame which hasn't been read yet, if there is any. Skips frames which have been overwritten.
+            [[nodiscard]]
+            auto Poll() -> std::optional<PublishedFrame>;
+
+            /// Number of frames which have been overwritten before this subscriber could read them.
+            [[nodiscard]]
+            auto GetMissedFrames() const -> std::uint64_t;
+
+        private:
+            ResultBus const& bus_;
+            std::uint64_t next_sequence_;
+            std::uint64_t missed_frames_{0};
+        };
+
+        /// @param capacity number of frames which are kept for the readers.
+        explicit ResultBus(std::size_t capacity = 64);
+
+        /**
+         * Publish the results of an analysed frame. Never blocks, but must not be called concurrently.
+         *
+         * @param results the results of all bananas found in the frame.
+         * @param captured_at when the frame has been captured.
+         * @return the sequence number of the frame.
+         */
+        auto Publish(std::list<AnalysisResult> const& results, Clock::time_point captured_at) -> std::uint64_t;
+
+        /// The most recently published frame, if any frame has been published yet.
+        [[nodiscard]]
+        auto ReadLatest() const -> std::optional<PublishedFrame>;
+
+        /// Read the frame with the given sequence number, if it is still available.
+        [[nodiscard]]
+        auto Read(std::uint64_t sequence) const -> std::expected<PublishedFrame, ReadError>;
+
+        /// Number of frames published so far, which is also the sequence number of the next frame.
+        [[nodiscard]]
+        auto GetPublishedFrames() const -> std::uint64_t;
+
+        [[nodiscard]]
+        auto GetCapacity() const -> std::size_t;
+
+    private:
+        static constexpr std::size_t kFrameWords = sizeof(PublishedFrame) / sizeof(std::uint64_t);
+
+        struct Slot {
+            /// 2 * sequence + 1 while the frame with this sequence number is being written, 2 * sequence + 2 once it's complete. 0 if unused.
+            std::atomic<std::uint64_t> stamp{0};
+            /// The frame, stored in atomic words so that reading it while it's being overwritten is no data race.
+            std::array<std::atomic<std::uint64_t>, kFrameWords> words;
+        };
+
+        std::size_t const capacity_;
+        std::unique_ptr<Slot[]> slots_;
+        std::atomic<std::uint64_t> published_frames_{0};
+    };
+
+}
+
+#endif //BANANA_PROJECT_RESULT_BUS_HPP
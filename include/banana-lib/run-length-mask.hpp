@@ -0,0 +1,88 @@
+#ifndef BANANA_PROJECT_RUN_LENGTH_MASK_HPP
+#define BANANA_PROJECT_RUN_LENGTH_MASK_HPP
+
+#include <compare>
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+namespace banana {
+
+    /// The set pixels [x_begin, x_end) of row y of a mask.
+    struct PixelRun {
+        int y;
+        int x_begin;
+        int x_end;
+
+        /// Sorted by row, then by column.
+        auto operator<=>(PixelRun const&) const = default;
+    };
+
+    /**
+     * Binary image stored as the runs of its set pixels. Its size grows with the outline of the objects rather than with
+     * the area they cover, and masks of different regions of an image can be joined by simply joining their runs.
+     *
+     * This is used to stitch objects which have been detected in separate bands of an image (see
+     * `Analyzer::Settings::detection_band_height`) without creating a mask of the region they cover.
+     */
+    class RunLengthMask {
+    public:
+        /**
+         * Create the mask from its runs.
+         *
+         * @param runs the set pixels, in any order. Runs must not overlap but may be adjacent.
+         */
+        explicit RunLengthMask(std::vector<PixelRun> runs);
+
+        /**
+         * Collect the runs of an 8 bit mask.
+         *
+         * @param mask single channel 8 bit image, all non-zero pixels are set.
+         * @param offset position of the mask in the image, added to the coordinates of the runs.
+         */
+        [[nodiscard]]
+        static auto FromMat(cv::Mat const& mask, cv::Point offset = {}) -> RunLengthMask;
+
+        /// The runs, sorted by row and column.
+        [[nodiscard]]
+        auto GetRuns() const -> std::span<PixelRun const>;
+
+        /// Bounding box of the set pixels, empty if there are none.
+        [[nodiscard]]
+        auto GetBounds() const -> cv::Rect;
+
+        [[nodiscard]]
+        auto IsSet(cv::Point const& point) const -> bool;
+
+        /// Split the mask into its 8-connected components, ordered by their first pixel (top-most, then left-most).
+        [[nodiscard]]
+        auto SplitComponents() const -> std::vector<RunLengthMask>;
+
+        /**
+         * Trace the external contour of the mask, which must consist of a single 8-connected component (see
+         * `SplitComponents`).
+         *
+         * @return the same contour as `cv::findContours` with `cv::RETR_EXTERNAL` and `cv::CHAIN_APPROX_SIMPLE` finds
+         * for this component. Empty if the mask is empty.
+         */
+        [[nodiscard]]
+        auto TraceExternalContour() const -> std::vector<cv::Point>;
+
+    private:
+        /// The runs of a row of `bounds_`.
+        [[nodiscard]]
+        auto GetRow(int y) const -> std::span<PixelRun const>;
+
+        std::vector<PixelRun> runs_;
+
+        cv::Rect bounds_;
+
+        /// Index of the first run of each row of `bounds_`, followed by the number of runs.
+        std::vector<std::size_t> row_starts_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_RUN_LENGTH_MASK_HPP
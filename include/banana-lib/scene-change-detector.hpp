@@ -0,0 +1,83 @@
+#ifndef BANANA_PROJECT_SCENE_CHANGE_DETECTOR_HPP
+#define BANANA_PROJECT_SCENE_CHANGE_DETECTOR_HPP
+
+#include <cstddef>
+
+#include <opencv2/opencv.hpp>
+
+namespace banana {
+
+    /**
+     * Cheap detector for changes between the frames of a video, used to skip the analysis of frames which show the same
+     * scene as the last analysed frame (e.g. when the conveyor is stopped or empty).
+     *
+     * The frames are compared on a heavily downsampled grayscale version in which each cell is the mean of a block of
+     * the frame, thus sensor noise and compression artefacts are mostly averaged out.
+     *
+     * Note that this keeps state about the previous frames and is thus not thread-safe. Use one instance per video source.
+     */
+    class SceneChangeDetector {
+    public:
+        struct Settings {
+            /// Size of the downsampled image on which the frames are compared.
+            cv::Size const signature_size{64, 36};
+
+            /// Minimum difference of the mean gray value of a cell (0 - 255) for it to count as changed.
+            int const cell_difference_threshold{12};
+
+            /// Fraction of the cells which must have changed for the scene to count as changed.
+            double const changed_cells_threshold{0.002};
+
+            /// After how many skipped frames in a row an analysis is forced, even if the scene didn't change. 0 = never force an analysis.
+            std::size_t const max_skipped_frames{100};
+        };
+
+        /// Counters for the decisions taken so far.
+        struct Stats {
+            /// Number of frames which needed to be analysed.
+            std::size_t analyzed_frames;
+
+            /// Number of frames for which the analysis could be skipped.
+            std::size_t skipped_frames;
+        };
+
+        explicit SceneChangeDetector(Settings settings);
+
+        /**
+         * Check whether a frame needs to be analysed or whether the results of the last analysed frame are still valid.
+         * If it needs to be analysed the frame becomes the new reference for the following frames.
+         *
+         * @param frame the current frame of the video.
+         * @return whether the scene changed since the last analysed frame (or a refresh is due).
+         */
+        [[nodiscard]]
+        auto NeedsAnalysis(cv::Mat const& frame) -> bool;
+
+        /**
+         * Forget the reference frame, thus the next frame will need to be analysed.
+         * Use this if the analysis of a frame for which `NeedsAnalysis` returned `true` failed.
+         */
+        void Reset();
+
+        [[nodiscard]]
+        auto GetStats() const -> Stats;
+
+    private:
+        /// Calculate the downsampled grayscale image used to compare the frames.
+        [[nodiscard]]
+        auto CalculateSignature(cv::Mat const& frame) const -> cv::Mat;
+
+        Settings const settings_;
+
+        /// Signature of the last analysed frame. Empty if there is none.
+        cv::Mat reference_signature_;
+
+        /// Number of frames skipped since the last analysed frame.
+        std::size_t skipped_in_a_row_{0};
+
+        Stats stats_{};
+    };
+
+}
+
+#endif //BANANA_PROJECT_SCENE_CHANGE_DETECTOR_HPP
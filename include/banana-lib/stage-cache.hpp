@@ -0,0 +1,83 @@
+#ifndef BANANA_PROJECT_STAGE_CACHE_HPP
+#define BANANA_PROJECT_STAGE_CACHE_HPP
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <banana-lib/lib.hpp>
+
+namespace banana {
+
+    /**
+     * Incremental 64-bit hash (FNV-1a on 64-bit words) used to derive the keys of the `StageCache`.
+     * This is not a cryptographic hash, it's only meant to tell different images and settings apart.
+     */
+    class StageHasher {
+    public:
+        auto Add(std::span<std::byte const> data) -> StageHasher&;
+        auto Add(std::uint64_t value) -> StageHasher&;
+        auto Add(double value) -> StageHasher&;
+        auto Add(cv::Scalar const& value) -> StageHasher&;
+        auto Add(Contour const& contour) -> StageHasher&;
+
+        [[nodiscard]]
+        auto Get() const -> std::uint64_t;
+
+    private:
+        std::uint64_t hash_{14695981039346656037ull};
+    };
+
+    /**
+     * On-disk cache for the intermediate results of the analysis, used to only re-calculate the stages of the analysis
+     * which are affected by changed settings when analysing the same images again (e.g. when tuning the ripeness colours).
+     *
+     * The entries are keyed by a hash of the image content and a hash of the settings the stage depends on, thus there
+     * is no need to ever invalidate entries: changed images or settings simply lead to different keys.
+     * Each entry is a separate (small) file, written atomically. Multiple processes can share the same cache directory.
+     *
+     * @see Analyzer::AnalyzeImage(cv::Mat const&, StageCache const&)
+     */
+    class StageCache {
+    public:
+        /**
+         * Open the cache in the specified directory, creating the directory if needed.
+         *
+         * @param directory the directory in which the entries are stored.
+         */
+        explicit StageCache(std::filesystem::path directory);
+
+        /// Calculate the hash of the content of an image, used as key for the entries.
+        [[nodiscard]]
+        static auto HashImage(cv::Mat const& image) -> std::uint64_t;
+
+        /// Load the shapes of the bananas found in an image, if they have been stored for these settings.
+        [[nodiscard]]
+        auto LoadShapes(std::uint64_t image_hash, std::uint64_t settings_hash) const -> std::optional<std::vector<BananaShape>>;
+
+        /// Store the shapes of the bananas found in an image. Failures are ignored, the shapes will just be calculated again.
+        void StoreShapes(std::uint64_t image_hash, std::uint64_t settings_hash, std::vector<BananaShape> const& shapes) const;
+
+        /// Load the ripeness of the bananas found in an image, if they have been stored for these settings.
+        [[nodiscard]]
+        auto LoadRipeness(std::uint64_t image_hash, std::uint64_t settings_hash) const -> std::optional<std::vector<RipenessEstimate>>;
+
+        /// Store the ripeness of the bananas found in an image. Failures are ignored, the ripeness will just be calculated again.
+        void StoreRipeness(std::uint64_t image_hash, std::uint64_t settings_hash, std::vector<RipenessEstimate> const& ripeness) const;
+
+    private:
+        /// Path of the file for an entry.
+        [[nodiscard]]
+        auto GetEntryPath(std::uint64_t image_hash, std::uint64_t settings_hash, std::string const& stage) const -> std::filesystem::path;
+
+        std::filesystem::path const directory_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_STAGE_CACHE_HPP
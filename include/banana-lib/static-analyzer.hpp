@@ -0,0 +1,293 @@
+#ifndef BANANA_PROJECT_STATIC_ANALYZER_HPP
+#define BANANA_PROJECT_STATIC_ANALYZER_HPP
+
+#include <array>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <expected>
+#include <list>
+#include <utility>
+#include <vector>
+
+#include <opencv2/opencv.hpp>
+
+#include <banana-lib/lib.hpp>
+
+namespace banana {
+
+    /// A range of HSV colours (in the OpenCV convention: H = 0 - 179, S & V = 0 - 255). Both bounds are inclusive.
+    struct HSVRange {
+        std::array<std::uint8_t, 3> lower;
+        std::array<std::uint8_t, 3> upper;
+    };
+
+    /**
+     * The settings of a `StaticAnalyzer`. These correspond to `Analyzer::Settings` (incl. the same defaults), but are known at compile time.
+     */
+    struct StaticSettings {
+        /// Whether verbose annotations should be used when annotating the image. If disabled the code for them is not compiled in.
+        bool verbose_annotations{false};
+
+        /// Maximum score of `cv::matchShapes` which we still accept as a banana.
+        float match_max_score{0.6f};
+
+        /// Minimum area value of a banana (in px^2).
+        float min_area{1e5f};
+
+        /// Maximum area value of a banana (in px^2).
+        float max_area{1e7f};
+
+        /// How long (in pixels) is a meter? This is the extrinsic calibration needed to calculate sizes.
+        double pixels_per_meter;
+
+        /// Color (BGR) used to annotate the contours on the analyzed image.
+        std::array<std::uint8_t, 3> contour_annotation_color{0, 255, 0};
+        /// Color (BGR) used to annotate debug information on the analyzed image.
+        std::array<std::uint8_t, 3> helper_annotation_color{0, 0, 255};
+
+        /// Color ranges used to identify the ripeness.
+        HSVRange green{{35, 50, 50}, {85, 255, 255}};
+        HSVRange yellow{{20, 100, 100}, {30, 255, 255}};
+        HSVRange brown{{10, 100, 20}, {20, 200, 100}};
+
+        /// Color range used to filter the incoming colors when searching for bananas.
+        HSVRange filter{{0, 41, 0}, {177, 255, 255}};
+
+        /// Size of the kernel used to remove noise from the detection mask.
+        int morph_kernel_size{5};
+
+        /// Size of the kernel used to smooth the detection mask.
+        int blur_kernel_size{37};
+    };
+
+    /** Internal helpers, do not use from the outside! */
+    namespace internal {
+        /// Bits in the classification of a pixel by the `StaticAnalyzer`, one per colour range.
+        enum ColorClass : std::uint8_t {
+            kFilter = 1 << 0,
+            kGreen = 1 << 1,
+            kYellow = 1 << 2,
+            kBrown = 1 << 3,
+        };
+
+        /**
+         * Build the lookup table for one channel of the HSV image: entry `v` has the bits of all colour ranges set for
+         * which `v` lies within the range on this channel. A pixel lies within a colour range if the bit is set in the
+         * lookup tables of all three channels.
+         */
+        constexpr auto BuildChannelLut(StaticSettings const& settings, std::size_t const channel) -> std::array<std::uint8_t, 256> {
+            std::array<std::pair<HSVRange, ColorClass>, 4> const ranges{{
+                {settings.filter, kFilter},
+                {settings.green, kGreen},
+                {settings.yellow, kYellow},
+                {settings.brown, kBrown},
+            }};
+
+            std::array<std::uint8_t, 256> lut{};
+            for (std::size_t value = 0; value < lut.size(); ++value) {
+                for (auto const& [range, color_class] : ranges) {
+                    if (range.lower[channel] <= value && value <= range.upper[channel]) {
+                        lut[value] |= color_class;
+                    }
+                }
+            }
+            return lut;
+        }
+    }
+
+    /**
+     * Variant of `Analyzer` for configurations which are fixed at compile time.
+     *
+     * The colour classification of all pixels is done in a single pass over the image using lookup tables which are
+     * built at compile time (instead of one `cv::inRange` on a separately converted image per colour range), the kernel
+     * sizes are compile time constants and the code for the verbose annotations is only compiled in if they're enabled.
+     * The analysis of the banana shapes is shared with `Analyzer`, thus the results are identical to the ones of an
+     * `Analyzer` with the same settings.
+     *
+     * @tparam kSettings the settings of the analyzer.
+     */
+    template<StaticSettings kSettings>
+    class StaticAnalyzer {
+        static_assert(kSettings.morph_kernel_size > 0 && kSettings.morph_kernel_size % 2 == 1, "the morph kernel size must be odd");
+        static_assert(kSettings.blur_kernel_size > 1 && kSettings.blur_kernel_size % 2 == 1, "the blur kernel size must be odd and greater than 1");
+
+    public:
+        StaticAnalyzer() : analyzer_(ToRuntimeSettings()) {
+        }
+
+        /**
+         * Analyse an image for the presence of bananas and their properties.
+         *
+         * @param image an image possibly containing bananas
+         * @return the analysis results for each banana which has been found. If no banana has been found this list is empty.
+         * @see Analyzer::AnalyzeImage
+         */
+        [[nodiscard]]
+        auto AnalyzeImage(cv::Mat const& image) const -> std::expected<std::list<AnalysisResult>, AnalysisError> {
+            if (image.data == nullptr) {
+                return std::unexpected{AnalysisError::kInvalidImage};
+            }
+
+            auto [classes, detection_mask] = ClassifyPixels(image);
+
+            std::list<AnalysisResult> analysis_results;
+            for (auto const& contour : this->FindBananaContours(std::move(detection_mask))) {
+                auto const result = analyzer_.AnalyzeBananaContour(contour, IdentifyBananaRipeness(classes, contour));
+                if (!result) {
+                    return std::unexpected{result.error()};
+                }
+                analysis_results.push_back(*result);
+            }
+
+            return analysis_results;
+        }
+
+        /**
+         * Analyse an image for the presence of bananas and their properties.
+         *
+         * @param image an image possibly containing bananas
+         * @return the result of the analysis and the annotated image, see the description of AnnotatedAnalysisResult for more details.
+         * @see Analyzer::AnalyzeAndAnnotateImage
+         */
+        [[nodiscard]]
+        auto AnalyzeAndAnnotateImage(cv::Mat const& image) const -> std::expected<AnnotatedAnalysisResult, AnalysisError> {
+            return this->AnalyzeImage(image)
+                .and_then([&image, this](auto const& analysis_result) -> std::expected<AnnotatedAnalysisResult, AnalysisError> {
+                    return AnnotatedAnalysisResult{this->AnnotateImage(image, analysis_result), analysis_result};
+                });
+        }
+
+        /**
+         * Annotate an image with the result from a previous analysis.
+         *
+         * @see Analyzer::AnnotateImage
+         */
+        [[nodiscard]]
+        auto AnnotateImage(cv::Mat const& image, std::list<AnalysisResult> const& analysis_result) const -> cv::Mat {
+            if constexpr (kSettings.verbose_annotations) {
+                return analyzer_.AnnotateImage(image, analysis_result);
+            } else {
+                auto annotated_image = cv::Mat{image};
+                for (auto const& result : analysis_result) {
+                    cv::drawContours(annotated_image, std::vector{{result.contour}}, -1, ToScalar(kSettings.contour_annotation_color), 3);
+                }
+                return annotated_image;
+            }
+        }
+
+    private:
+        static constexpr auto kHueLut = internal::BuildChannelLut(kSettings, 0);
+        static constexpr auto kSaturationLut = internal::BuildChannelLut(kSettings, 1);
+        static constexpr auto kValueLut = internal::BuildChannelLut(kSettings, 2);
+
+        static auto ToScalar(std::array<std::uint8_t, 3> const& value) -> cv::Scalar {
+            return {static_cast<double>(value[0]), static_cast<double>(value[1]), static_cast<double>(value[2])};
+        }
+
+        static auto ToRuntimeSettings() -> Analyzer::Settings {
+            return {
+                .verbose_annotations = kSettings.verbose_annotations,
+                .match_max_score = kSettings.match_max_score,
+                .min_area = kSettings.min_area,
+                .max_area = kSettings.max_area,
+                .pixels_per_meter = kSettings.pixels_per_meter,
+                .contour_annotation_color = ToScalar(kSettings.contour_annotation_color),
+                .helper_annotation_color = ToScalar(kSettings.helper_annotation_color),
+                .green_lower_threshold_color = ToScalar(kSettings.green.lower),
+                .green_upper_threshold_color = ToScalar(kSettings.green.upper),
+                .yellow_lower_threshold_color = ToScalar(kSettings.yellow.lower),
+                .yellow_upper_threshold_color = ToScalar(kSettings.yellow.upper),
+                .brown_lower_threshold_color = ToScalar(kSettings.brown.lower),
+                .brown_upper_threshold_color = ToScalar(kSettings.brown.upper),
+                .filter_lower_threshold_color = ToScalar(kSettings.filter.lower),
+                .filter_upper_threshold_color = ToScalar(kSettings.filter.upper),
+            };
+        }
+
+        /**
+         * Classify all pixels of the image in a single pass.
+         *
+         * @param image the image to be classified (BGR).
+         * @return the colour classes of each pixel (see `internal::ColorClass`) and the (not yet smoothed) binary detection mask.
+         */
+        static auto ClassifyPixels(cv::Mat const& image) -> std::pair<cv::Mat, cv::Mat> {
+            cv::Mat hsv_image;
+            cv::cvtColor(image, hsv_image, cv::COLOR_BGR2HSV);
+
+            cv::Mat classes{hsv_image.size(), CV_8UC1};
+            cv::Mat detection_mask{hsv_image.size(), CV_8UC1};
+            cv::parallel_for_(cv::Range{0, hsv_image.rows}, [&](cv::Range const& rows) {
+                for (auto y = rows.start; y < rows.end; ++y) {
+                    auto const* const hsv_row = hsv_image.ptr<cv::Vec3b>(y);
+                    auto* const classes_row = classes.ptr<std::uint8_t>(y);
+                    auto* const mask_row = detection_mask.ptr<std::uint8_t>(y);
+                    for (auto x = 0; x < hsv_image.cols; ++x) {
+                        auto const pixel_classes = kHueLut[hsv_row[x][0]] & kSaturationLut[hsv_row[x][1]] & kValueLut[hsv_row[x][2]];
+                        classes_row[x] = static_cast<std::uint8_t>(pixel_classes);
+                        mask_row[x] = (pixel_classes & internal::kFilter) ? 255 : 0;
+                    }
+                }
+            });
+
+            return {classes, detection_mask};
+        }
+
+        /**
+         * Identify all bananas in the detection mask and return their contours.
+         *
+         * @param detection_mask the binary mask of all pixels within the filter range. Will be modified!
+         * @see Analyzer::FindBananaContours
+         */
+        auto FindBananaContours(cv::Mat detection_mask) const -> Contours {
+            // Removing noise
+            static cv::Mat const kKernel = cv::Mat::ones(kSettings.morph_kernel_size, kSettings.morph_kernel_size, CV_8UC1);
+            cv::morphologyEx(detection_mask, detection_mask, cv::MORPH_OPEN, kKernel);
+
+            // Smooth the image
+            cv::medianBlur(detection_mask, detection_mask, kSettings.blur_kernel_size);
+
+            auto contours = analyzer_.FindCandidateContours(detection_mask);
+            std::erase_if(contours, [this](auto const& contour) -> auto {
+                return !analyzer_.IsBananaContour(contour);
+            });
+
+            return contours;
+        }
+
+        /**
+         * Identify the ripeness of the banana by counting the classified pixels inside of its contour.
+         *
+         * @see Analyzer::IdentifyBananaRipeness
+         */
+        static auto IdentifyBananaRipeness(cv::Mat const& classes, Contour const& contour) -> float {
+            auto const bounds = cv::boundingRect(contour);
+            cv::Mat inside{bounds.size(), CV_8UC1, cv::Scalar{0}};
+            cv::drawContours(inside, std::vector{{contour}}, -1, cv::Scalar{255}, cv::FILLED, cv::LINE_8, cv::noArray(), INT_MAX, -bounds.tl());
+
+            auto const banana_classes = classes(bounds);
+            int green_pixel_count = 0, yellow_pixel_count = 0, brown_pixel_count = 0;
+            for (auto y = 0; y < bounds.height; ++y) {
+                auto const* const classes_row = banana_classes.ptr<std::uint8_t>(y);
+                auto const* const inside_row = inside.ptr<std::uint8_t>(y);
+                for (auto x = 0; x < bounds.width; ++x) {
+                    auto const pixel_classes = classes_row[x] & inside_row[x];
+                    green_pixel_count += (pixel_classes & internal::kGreen) != 0;
+                    yellow_pixel_count += (pixel_classes & internal::kYellow) != 0;
+                    brown_pixel_count += (pixel_classes & internal::kBrown) != 0;
+                }
+            }
+
+            auto const total_pixel_count = green_pixel_count + yellow_pixel_count + brown_pixel_count;
+            float green_share = static_cast<float>(green_pixel_count) / (static_cast<float>(total_pixel_count)+1e-3f);
+            float brown_share = static_cast<float>(brown_pixel_count) / (static_cast<float>(total_pixel_count)+1e-3f);
+            return 1 - green_share + brown_share;
+        }
+
+        /// Runtime analyzer with the same settings, used for the analysis of the banana shapes.
+        Analyzer const analyzer_;
+    };
+
+}
+
+#endif //BANANA_PROJECT_STATIC_ANALYZER_HPP
@@ -0,0 +1,165 @@
+/**\file
+ * \brief Header-only incremental least-squares fit of a 2-dimensional polynomial (i.e. 3 coefficients) to a changing set of weighted points.
+ */
+
+#ifndef BANANA_PROJECT_POLYNOMIAL2DACCUMULATOR_HPP
+#define BANANA_PROJECT_POLYNOMIAL2DACCUMULATOR_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <expected>
+#include <limits>
+#include <ranges>
+#include <tuple>
+#include <utility>
+
+namespace polyfit {
+
+    /// Reasons why `Polynomial2DAccumulator::GetCoefficients` can't provide coefficients.
+    enum class AccumulatorError {
+        /// The points don't determine a unique polynomial, e.g. because there are less than 3 distinct x coordinates (or no points at all).
+        kUnderdetermined,
+    };
+
+    /**
+     * Stateful weighted least-squares fit of `y = a0 + a1 * x + a2 * x^2`.
+     *
+     * Only the sufficient statistics of the problem (the weighted sums of `x^0 .. x^4`, `y`, `x * y` and `x^2 * y`) are
+     * kept, thus adding and removing a point is O(1) and the coefficients can be calculated at any time by solving the
+     * 3x3 normal equations. This allows updating a fit when only a few of its points change (e.g. the contour of a tracked
+     * banana between two frames) instead of refitting all of them.
+     *
+     * The points are stored relative to `x_origin` to keep the sums well-conditioned: pass a value close to the middle of
+     * the expected x coordinates (e.g. the center of the image) when they are far away from 0.
+     *
+     * Note that removing a point only gives the same result as never having added it if exactly the same values are passed.
+     */
+    class Polynomial2DAccumulator {
+    public:
+        explicit Polynomial2DAccumulator(double const x_origin = 0) : x_origin_(x_origin) {}
+
+        /**
+         * Create the accumulator and add all points (with weight 1).
+         *
+         * @tparam R the underlying container supporting ranges. must contain std::pair<double, double>
+         */
+        template<std::ranges::range R>
+        explicit Polynomial2DAccumulator(R&& points, double const x_origin = 0) : x_origin_(x_origin) {
+            for (auto const& point : points) {
+                this->Add(point.first, point.second);
+            }
+        }
+
+        /// Add a point to the fit. A point with weight `n` has the same effect as adding it `n` times.
+        void Add(double const x, double const y, double const weight = 1) {
+            this->Accumulate(x, y, weight);
+        }
+
+        /// Remove a point which has previously been added with the same weight.
+        void Remove(double const x, double const y, double const weight = 1) {
+            this->Accumulate(x, y, -weight);
+        }
+
+        /// Remove all points.
+        void Clear() {
+            x_power_sums_ = {};
+            x_power_magnitudes_ = {};
+            xy_power_sums_ = {};
+        }
+
+        /// The sum of the weights of all points currently part of the fit.
+        [[nodiscard]]
+        auto GetTotalWeight() const -> double {
+            return x_power_sums_[0];
+        }
+
+        /**
+         * Calculate the coefficients of the polynomial which fits the current points best (in the least-squares sense).
+         *
+         * @return either the coefficients `a0, a1, a2` or the reason why they can't be calculated.
+         */
+        [[nodiscard]]
+        auto GetCoefficients() const -> std::expected<std::tuple<double, double, double>, AccumulatorError> {
+            // normal equations: sum(u^(i+j)) * b_j = sum(u^i * y) for i, j in 0..2 (augmented with the right-hand side).
+            // the sums of the different powers of u differ by orders of magnitude (e.g. u^4 vs. 1 for pixel coordinates),
+            // thus the equations are scaled symmetrically to a unit diagonal, after which each pivot can be compared to 1.
+            std::array<double, 3> scales{};
+            for (std::size_t i = 0; i < 3; ++i) {
+                auto const diagonal = x_power_sums_[2 * i];
+                // removing all points may leave some rounding errors behind, these must not be mistaken for real points
+                if (!(diagonal > kSingularityTolerance * x_power_magnitudes_[2 * i])) {
+                    return std::unexpected{AccumulatorError::kUnderdetermined};
+                }
+                scales[i] = 1 / std::sqrt(diagonal);
+            }
+
+            std::array<std::array<double, 4>, 3> m{};
+            for (std::size_t i = 0; i < 3; ++i) {
+                for (std::size_t j = 0; j < 3; ++j) {
+                    m[i][j] = x_power_sums_[i + j] * scales[i] * scales[j];
+                }
+                m[i][3] = xy_power_sums_[i] * scales[i];
+            }
+
+            // gaussian elimination with partial pivoting
+            for (std::size_t col = 0; col < 3; ++col) {
+                auto const pivot = *std::ranges::max_element(std::views::iota(col, 3uz), {}, [&m, col](auto const row) { return std::abs(m[row][col]); });
+                if (std::abs(m[pivot][col]) <= kSingularityTolerance) {
+                    return std::unexpected{AccumulatorError::kUnderdetermined};
+                }
+                std::swap(m[col], m[pivot]);
+                for (auto row = col + 1; row < 3; ++row) {
+                    auto const factor = m[row][col] / m[col][col];
+                    for (auto k = col; k < 4; ++k) {
+                        m[row][k] -= factor * m[col][k];
+                    }
+                }
+            }
+
+            auto const s2 = m[2][3] / m[2][2];
+            auto const s1 = (m[1][3] - m[1][2] * s2) / m[1][1];
+            auto const s0 = (m[0][3] - m[0][1] * s1 - m[0][2] * s2) / m[0][0];
+            // undo the scaling
+            auto const b0 = s0 * scales[0];
+            auto const b1 = s1 * scales[1];
+            auto const b2 = s2 * scales[2];
+
+            // undo the shift: b0 + b1 * (x - c) + b2 * (x - c)^2
+            auto const c = x_origin_;
+            return {{b0 - b1 * c + b2 * c * c, b1 - 2 * b2 * c, b2}};
+        }
+
+    private:
+        /// Pivots of the scaled normal equations smaller than this are treated as 0, i.e. the system is considered to be singular.
+        static constexpr double kSingularityTolerance = 1e3 * std::numeric_limits<double>::epsilon();
+
+        void Accumulate(double const x, double const y, double const weight) {
+            auto const u = x - x_origin_;
+            auto term = weight;
+            for (std::size_t i = 0; i < x_power_sums_.size(); ++i) {
+                x_power_sums_[i] += term;
+                x_power_magnitudes_[i] += std::abs(term);
+                if (i < xy_power_sums_.size()) {
+                    xy_power_sums_[i] += term * y;
+                }
+                term *= u;
+            }
+        }
+
+        double x_origin_;
+
+        /// `sum(w * u^i)` for i in 0..4, with `u = x - x_origin_`.
+        std::array<double, 5> x_power_sums_{};
+
+        /// `sum(|w * u^i|)` over all points ever added or removed, i.e. the scale of the rounding errors in `x_power_sums_`.
+        std::array<double, 5> x_power_magnitudes_{};
+
+        /// `sum(w * u^i * y)` for i in 0..2.
+        std::array<double, 3> xy_power_sums_{};
+    };
+
+}
+
+#endif //BANANA_PROJECT_POLYNOMIAL2DACCUMULATOR_HPP
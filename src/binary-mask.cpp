@@ -0,0 +1,274 @@
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <limits>
+
+#include <banana-lib/binary-mask.hpp>
+
+namespace banana {
+
+    /// Number of pixels stored in one word.
+    constexpr int kBitsPerWord = std::numeric_limits<std::uint64_t>::digits;
+
+    /// The packing works on 8 pixels at a time, loaded as one word.
+    static_assert(std::endian::native == std::endian::little, "the packing of the pixels assumes a little-endian platform");
+
+    /// Every stripe of the majority filter has to initialise its counts over a whole window first, thus the stripes shouldn't be much smaller than this (in multiples of the kernel size).
+    constexpr int kMinStripeHeightInKernels = 4;
+
+    namespace {
+        /// Pack 8 pixels into the bits of a byte (first pixel in the least significant bit), all non-zero pixels are set.
+        auto PackEightPixels(std::uint8_t const* const pixels) -> std::uint8_t {
+            std::uint64_t bytes;
+            std::memcpy(&bytes, pixels, sizeof(bytes));
+            // set the highest bit of every non-zero byte (without carries between the bytes), then gather these bits
+            auto const non_zero = (((bytes & 0x7F7F7F7F7F7F7F7Full) + 0x7F7F7F7F7F7F7F7Full) | bytes) & 0x8080808080808080ull;
+            return static_cast<std::uint8_t>(((non_zero >> 7) * 0x0102040810204080ull) >> 56);
+        }
+
+        /// Inverse of `PackEightPixels`, set pixels become 255.
+        void UnpackEightPixels(std::uint8_t const bits, std::uint8_t* const pixels) {
+            // move bit `i` into byte `i`, then turn every non-zero byte into 255
+            auto const spread = (bits * 0x0101010101010101ull) & 0x8040201008040201ull;
+            auto const bytes = ((((spread + 0x7F7F7F7F7F7F7F7Full) | spread) & 0x8080808080808080ull) >> 7) * 0xFF;
+            std::memcpy(pixels, &bytes, sizeof(bytes));
+        }
+    }
+
+    BinaryMask::BinaryMask(int const rows, int const cols)
+            : rows_(rows), cols_(cols),
+              words_per_row_((static_cast<std::size_t>(cols) + kBitsPerWord - 1) / kBitsPerWord),
+              words_(static_cast<std::size_t>(rows) * words_per_row_, 0) {
+    }
+
+    auto BinaryMask::FromMat(cv::Mat const& mask) -> BinaryMask {
+        CV_Assert(mask.type() == CV_8UC1);
+
+        BinaryMask result{mask.rows, mask.cols};
+        cv::parallel_for_(cv::Range{0, mask.rows}, [&](cv::Range const& range) {
+            for (auto y = range.start; y < range.end; ++y) {
+                auto const* const pixels = mask.ptr<std::uint8_t>(y);
+                auto const row = result.Row(y);
+                for (std::size_t w = 0; w < row.size(); ++w) {
+                    auto const first = static_cast<int>(w) * kBitsPerWord;
+                    auto const count = std::min(kBitsPerWord, mask.cols - first);
+                    std::uint64_t word = 0;
+                    auto b = 0;
+                    for (; b + 8 <= count; b += 8) {
+                        word |= static_cast<std::uint64_t>(PackEightPixels(pixels + first + b)) << b;
+                    }
+                    for (; b < count; ++b) {
+                        word |= static_cast<std::uint64_t>(pixels[first + b] != 0) << b;
+                    }
+                    row[w] = word;
+                }
+            }
+        });
+        return result;
+    }
+
+    auto BinaryMask::ToMat() const -> cv::Mat {
+        cv::Mat mask{rows_, cols_, CV_8UC1};
+        cv::parallel_for_(cv::Range{0, rows_}, [&](cv::Range const& range) {
+            for (auto y = range.start; y < range.end; ++y) {
+                auto* const pixels = mask.ptr<std::uint8_t>(y);
+                auto const row = this->Row(y);
+                auto x = 0;
+                for (; x + 8 <= cols_; x += 8) {
+                    UnpackEightPixels(static_cast<std::uint8_t>(row[x / kBitsPerWord] >> (x % kBitsPerWord)), pixels + x);
+                }
+                for (; x < cols_; ++x) {
+                    pixels[x] = ((row[x / kBitsPerWord] >> (x % kBitsPerWord)) & 1) != 0 ? 255 : 0;
+                }
+            }
+        });
+        return mask;
+    }
+
+    auto BinaryMask::Rows() const -> int {
+        return rows_;
+    }
+
+    auto BinaryMask::Cols() const -> int {
+        return cols_;
+    }
+
+    auto BinaryMask::Row(int const y) -> std::span<std::uint64_t> {
+        return {words_.data() + static_cast<std::size_t>(y) * words_per_row_, words_per_row_};
+    }
+
+    auto BinaryMask::Row(int const y) const -> std::span<std::uint64_t const> {
+        return {words_.data() + static_cast<std::size_t>(y) * words_per_row_, words_per_row_};
+    }
+
+    auto BinaryMask::Erode(int const kernel_size) const -> BinaryMask {
+        return this->ApplyRectKernel(kernel_size, true);
+    }
+
+    auto BinaryMask::Dilate(int const kernel_size) const -> BinaryMask {
+        return this->ApplyRectKernel(kernel_size, false);
+    }
+
+    auto BinaryMask::Open(int const kernel_size) const -> BinaryMask {
+        return this->Erode(kernel_size).Dilate(kernel_size);
+    }
+
+    auto BinaryMask::LastWordMask() const -> std::uint64_t {
+        auto const used_bits = cols_ % kBitsPerWord;
+        return used_bits == 0 ? ~std::uint64_t{0} : (std::uint64_t{1} << used_bits) - 1;
+    }
+
+    void BinaryMask::ShiftRow(int const y, int const offset, bool const border, std::span<std::uint64_t> const result) const {
+        auto const row = this->Row(y);
+        auto const border_word = border ? ~std::uint64_t{0} : std::uint64_t{0};
+        auto const last_word_mask = this->LastWordMask();
+        auto const num_words = static_cast<std::ptrdiff_t>(row.size());
+
+        /// Word `i` of the row, with the pixels outside of the image set to the border value.
+        auto const source = [&](std::ptrdiff_t const i) -> std::uint64_t {
+            if (i < 0 || i >= num_words) {
+                return border_word;
+            }
+            if (i == num_words - 1) {
+                return (row[i] & last_word_mask) | (border_word & ~last_word_mask);
+            }
+            return row[i];
+        };
+
+        // split the offset into whole words and the remaining bits (rounding towards negative infinity)
+        auto const word_offset = static_cast<std::ptrdiff_t>(offset >= 0 ? offset / kBitsPerWord : -((-offset + kBitsPerWord - 1) / kBitsPerWord));
+        auto const bit_offset = offset - static_cast<int>(word_offset) * kBitsPerWord;
+
+        for (std::ptrdiff_t w = 0; w < num_words; ++w) {
+            auto const low = source(w + word_offset) >> bit_offset;
+            auto const high = bit_offset == 0 ? 0 : source(w + word_offset + 1) << (kBitsPerWord - bit_offset);
+            result[w] = low | high;
+        }
+        result.back() &= last_word_mask;
+    }
+
+    auto BinaryMask::ApplyRectKernel(int const kernel_size, bool const is_erosion) const -> BinaryMask {
+        CV_Assert(kernel_size > 0);
+        // same anchor as OpenCV uses by default: the window of `x` is `[x - kernel_size / 2, x - kernel_size / 2 + kernel_size)`
+        auto const first_offset = -(kernel_size / 2);
+        auto const combine = [is_erosion](std::uint64_t const a, std::uint64_t const b) { return is_erosion ? a & b : a | b; };
+
+        // horizontal pass: combine the row with its shifted copies. the kernel is separable as it's a rectangle.
+        BinaryMask horizontal{rows_, cols_};
+        cv::parallel_for_(cv::Range{0, rows_}, [&](cv::Range const& range) {
+            std::vector<std::uint64_t> shifted(words_per_row_);
+            for (auto y = range.start; y < range.end; ++y) {
+                auto const row = horizontal.Row(y);
+                this->ShiftRow(y, first_offset, is_erosion, row);
+                for (auto offset = first_offset + 1; offset < first_offset + kernel_size; ++offset) {
+                    this->ShiftRow(y, offset, is_erosion, shifted);
+                    std::ranges::transform(row, shifted, row.begin(), combine);
+                }
+            }
+        });
+
+        // vertical pass: combine the rows within the window. rows outside of the image are neutral (set for erosion, not set for dilation).
+        BinaryMask result{rows_, cols_};
+        cv::parallel_for_(cv::Range{0, rows_}, [&](cv::Range const& range) {
+            for (auto y = range.start; y < range.end; ++y) {
+                auto const row = result.Row(y);
+                std::ranges::fill(row, is_erosion ? ~std::uint64_t{0} : std::uint64_t{0});
+                auto const first_row = std::max(0, y + first_offset);
+                auto const last_row = std::min(rows_, y + first_offset + kernel_size);
+                for (auto source_y = first_row; source_y < last_row; ++source_y) {
+                    std::ranges::transform(row, horizontal.Row(source_y), row.begin(), combine);
+                }
+                row.back() &= this->LastWordMask();
+            }
+        });
+
+        return result;
+    }
+
+    auto BinaryMask::MajorityFilter(int const kernel_size) const -> BinaryMask {
+        CV_Assert(kernel_size > 0 && kernel_size % 2 == 1);
+
+        BinaryMask result{rows_, cols_};
+        if (rows_ == 0 || cols_ == 0) {
+            return result;
+        }
+
+        auto const radius = kernel_size / 2;
+        auto const threshold = kernel_size * kernel_size / 2;
+        auto const clamp_row = [this](int const y) { return std::clamp(y, 0, rows_ - 1); };
+
+        auto const num_stripes = std::max(1.0, static_cast<double>(rows_) / (kMinStripeHeightInKernels * kernel_size));
+        cv::parallel_for_(cv::Range{0, rows_}, [&](cv::Range const& range) {
+            // number of set pixels per column within the rows of the window and the resulting row
+            std::vector<int> column_counts(cols_, 0);
+            std::vector<std::uint64_t> current(words_per_row_, 0);
+            // range of columns whose count changed since the resulting row has been updated
+            auto first_changed = cols_;
+            auto last_changed = -1;
+
+            /// Apply the difference between two rows to the column counts: `added` enters the window and `removed` leaves it.
+            auto const update_columns = [&](std::span<std::uint64_t const> const added, std::span<std::uint64_t const> const removed) {
+                for (std::size_t w = 0; w < words_per_row_; ++w) {
+                    for (auto [bits, delta] : {std::pair{added[w] & ~removed[w], 1}, std::pair{removed[w] & ~added[w], -1}}) {
+                        while (bits != 0) {
+                            auto const x = static_cast<int>(w) * kBitsPerWord + std::countr_zero(bits);
+                            column_counts[x] += delta;
+                            first_changed = std::min(first_changed, x);
+                            last_changed = std::max(last_changed, x);
+                            bits &= bits - 1;
+                        }
+                    }
+                }
+            };
+
+            /// Recalculate the pixels of the resulting row whose window contains a changed column, using a running sum over the column counts.
+            auto const update_result = [&] {
+                if (last_changed < first_changed) {
+                    return;
+                }
+                auto const column_count = [&](int const x) { return column_counts[std::clamp(x, 0, cols_ - 1)]; };
+                auto const first_x = std::max(0, first_changed - radius);
+                auto const last_x = std::min(cols_ - 1, last_changed + radius);
+
+                auto window_count = 0;
+                for (auto x = first_x - radius; x <= first_x + radius; ++x) {
+                    window_count += column_count(x);
+                }
+                for (auto x = first_x; x <= last_x; ++x) {
+                    auto const bit = std::uint64_t{1} << (x % kBitsPerWord);
+                    if (window_count > threshold) {
+                        current[x / kBitsPerWord] |= bit;
+                    } else {
+                        current[x / kBitsPerWord] &= ~bit;
+                    }
+                    window_count += column_count(x + radius + 1) - column_count(x - radius);
+                }
+
+                first_changed = cols_;
+                last_changed = -1;
+            };
+
+            // initialise the counts for the first row of the stripe
+            std::vector<std::uint64_t> const empty_row(words_per_row_, 0);
+            for (auto y = range.start - radius; y <= range.start + radius; ++y) {
+                update_columns(this->Row(clamp_row(y)), empty_row);
+            }
+            update_result();
+            std::ranges::copy(current, result.Row(range.start).begin());
+
+            // then slide the window down, only the pixels which differ between the entering and the leaving row change the counts
+            for (auto y = range.start + 1; y < range.end; ++y) {
+                auto const entering = clamp_row(y + radius);
+                auto const leaving = clamp_row(y - radius - 1);
+                if (entering != leaving) {
+                    update_columns(this->Row(entering), this->Row(leaving));
+                    update_result();
+                }
+                std::ranges::copy(current, result.Row(y).begin());
+            }
+        }, num_stripes);
+
+        return result;
+    }
+
+}
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <ranges>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <banana-lib/banana.h>
+#include <banana-lib/lib.hpp>
+
+struct banana_analyzer {
+    banana::Analyzer analyzer;
+};
+
+namespace {
+
+    /// See `banana_get_last_error_message`.
+    thread_local std::string last_error_message;
+
+    /// Target of the conversion of images which aren't BGR, kept per thread to avoid an allocation per frame.
+    thread_local cv::Mat conversion_buffer;
+
+    auto SetError(banana_status_t const status, std::string message) -> banana_status_t {
+        last_error_message = std::move(message);
+        return status;
+    }
+
+    auto ToStatus(banana::AnalysisError const error) -> banana_status_t {
+        switch (static_cast<banana::AnalysisError::Value>(error)) {
+            case banana::AnalysisError::kInvalidImage:
+                return SetError(BANANA_STATUS_INVALID_IMAGE, error.ToString());
+            case banana::AnalysisError::kPolynomialCalcFailure:
+                return SetError(BANANA_STATUS_POLYNOMIAL_CALC_FAILURE, error.ToString());
+        }
+        return SetError(BANANA_STATUS_INTERNAL_ERROR, error.ToString());
+    }
+
+    /**
+     * Wrap the pixels of the caller in a BGR `cv::Mat`. BGR images are not copied, the others are converted into the
+     * conversion buffer of the calling thread.
+     */
+    auto ToBgrMat(banana_image_t const& image) -> std::optional<cv::Mat> {
+        auto const [type, conversion] = [&image]() -> std::pair<int, int> {
+            switch (image.format) {
+                case BANANA_PIXEL_FORMAT_BGR8:
+                    return {CV_8UC3, -1};
+                case BANANA_PIXEL_FORMAT_RGB8:
+                    return {CV_8UC3, cv::COLOR_RGB2BGR};
+                case BANANA_PIXEL_FORMAT_BGRA8:
+                    return {CV_8UC4, cv::COLOR_BGRA2BGR};
+                case BANANA_PIXEL_FORMAT_RGBA8:
+                    return {CV_8UC4, cv::COLOR_RGBA2BGR};
+            }
+            return {-1, -1};
+        }();
+
+        if (type < 0 || image.data == nullptr || image.width <= 0 || image.height <= 0
+            || image.stride < static_cast<std::size_t>(image.width) * static_cast<std::size_t>(CV_ELEM_SIZE(type))) {
+            return std::nullopt;
+        }
+
+        // the analysis only reads the image, thus casting away the const is fine
+        cv::Mat const pixels{image.height, image.width, type, const_cast<void*>(image.data), image.stride};
+        if (conversion < 0) {
+            return pixels;
+        }
+        cv::cvtColor(pixels, conversion_buffer, conversion);
+        return conversion_buffer;
+    }
+
+    auto ToCResult(banana::AnalysisResult const& result) -> banana_result_t {
+        auto const bounding_box = cv::boundingRect(result.contour);
+        auto const& [coeff_0, coeff_1, coeff_2] = result.center_line.coefficients;
+        return {
+            .bounding_box = {bounding_box.x, bounding_box.y, bounding_box.width, bounding_box.height},
+            .estimated_center = {result.estimated_center.x, result.estimated_center.y},
+            .rotation_angle = result.rotation_angle,
+            .center_line_coefficients = {coeff_0, coeff_1, coeff_2},
+            .mean_curvature = result.mean_curvature,
+            .length = result.length,
+            .ripeness = result.ripeness,
+            .ripeness_uncertainty = result.ripeness_uncertainty,
+            .contour_offset = 0,
+            .contour_size = result.contour.size(),
+            .zone_id = result.zone_id.value_or(-1),
+        };
+    }
+
+    auto ToInspectionZones(banana_settings_t const& settings) -> std::vector<banana::InspectionZone> {
+        return std::span{settings.inspection_zones, settings.num_inspection_zones}
+               | std::views::transform([](banana_inspection_zone_t const& zone) -> banana::InspectionZone {
+                   return {
+                       .id = zone.id,
+                       .polygon = std::span{zone.points, zone.num_points}
+                                  | std::views::transform([](banana_point_t const& p) { return cv::Point{p.x, p.y}; })
+                                  | std::ranges::to<banana::Contour>(),
+                   };
+               })
+               | std::ranges::to<std::vector>();
+    }
+
+}
+
+extern "C" {
+
+int32_t banana_get_api_version(void) {
+    return BANANA_C_API_VERSION;
+}
+
+void banana_settings_init(banana_settings_t* const settings) {
+    if (settings == nullptr) {
+        return;
+    }
+    banana::Analyzer::Settings const defaults{
+        .pixels_per_meter = 0,
+    };
+    *settings = {
+        .match_max_score = defaults.match_max_score,
+        .min_area = defaults.min_area,
+        .max_area = defaults.max_area,
+        .pixels_per_meter = defaults.pixels_per_meter,
+        .detection_band_height = defaults.detection_band_height,
+        .ripeness_sample_budget = defaults.ripeness_sample_budget,
+        .ripeness_max_uncertainty = defaults.ripeness_max_uncertainty,
+        .bit_packed_detection_mask = defaults.bit_packed_detection_mask ? 1 : 0,
+        .inspection_zones = nullptr,
+        .num_inspection_zones = 0,
+    };
+}
+
+banana_status_t banana_analyzer_create(banana_settings_t const* const settings, banana_analyzer_t** const analyzer) {
+    if (settings == nullptr || analyzer == nullptr) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "settings and analyzer must not be null");
+    }
+    if (settings->pixels_per_meter <= 0) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "pixels_per_meter must be positive");
+    }
+    if (settings->inspection_zones == nullptr && settings->num_inspection_zones > 0) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "inspection_zones must not be null if num_inspection_zones is set");
+    }
+    if (std::ranges::any_of(std::span{settings->inspection_zones, settings->num_inspection_zones}, [](auto const& zone) { return zone.points == nullptr && zone.num_points > 0; })) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "the points of an inspection zone must not be null if num_points is set");
+    }
+
+    try {
+        *analyzer = new banana_analyzer{banana::Analyzer{{
+            .match_max_score = settings->match_max_score,
+            .min_area = settings->min_area,
+            .max_area = settings->max_area,
+            .pixels_per_meter = settings->pixels_per_meter,
+            .detection_band_height = settings->detection_band_height,
+            .ripeness_sample_budget = settings->ripeness_sample_budget,
+            .ripeness_max_uncertainty = settings->ripeness_max_uncertainty,
+            .bit_packed_detection_mask = settings->bit_packed_detection_mask != 0,
+            .inspection_zones = ToInspectionZones(*settings),
+        }}};
+        return BANANA_STATUS_OK;
+    } catch (std::invalid_argument const& ex) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, ex.what());
+    } catch (std::exception const& ex) {
+        return SetError(BANANA_STATUS_INTERNAL_ERROR, ex.what());
+    } catch (...) {
+        return SetError(BANANA_STATUS_INTERNAL_ERROR, "unknown error");
+    }
+}
+
+void banana_analyzer_destroy(banana_analyzer_t* const analyzer) {
+    delete analyzer;
+}
+
+banana_status_t banana_analyze(banana_analyzer_t const* const analyzer, banana_image_t const* const image, banana_output_t* const output) {
+    if (analyzer == nullptr || image == nullptr || output == nullptr) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "analyzer, image and output must not be null");
+    }
+    if (output->results == nullptr && output->results_capacity > 0) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "results must not be null if results_capacity is set");
+    }
+    if (output->contour_points == nullptr && output->contour_points_capacity > 0) {
+        return SetError(BANANA_STATUS_INVALID_ARGUMENT, "contour_points must not be null if contour_points_capacity is set");
+    }
+
+    try {
+        auto const bgr_image = ToBgrMat(*image);
+        if (!bgr_image) {
+            return SetError(BANANA_STATUS_INVALID_ARGUMENT, "invalid image description");
+        }
+
+        auto const analysis_result = analyzer->analyzer.AnalyzeImage(*bgr_image);
+        if (!analysis_result) {
+            return ToStatus(analysis_result.error());
+        }
+
+        auto status = BANANA_STATUS_OK;
+        output->num_results = 0;
+        output->num_contour_points = 0;
+        for (auto const& banana : *analysis_result) {
+            auto result = ToCResult(banana);
+            result.contour_offset = output->num_contour_points;
+
+            if (output->contour_points != nullptr) {
+                if (result.contour_offset + result.contour_size <= output->contour_points_capacity) {
+                    for (std::size_t i = 0; i < result.contour_size; ++i) {
+                        output->contour_points[result.contour_offset + i] = {banana.contour[i].x, banana.contour[i].y};
+                    }
+                } else {
+                    status = BANANA_STATUS_BUFFER_TOO_SMALL;
+                }
+            }
+            output->num_contour_points += result.contour_size;
+
+            if (output->num_results < output->results_capacity) {
+                output->results[output->num_results] = result;
+            } else {
+                status = BANANA_STATUS_BUFFER_TOO_SMALL;
+            }
+            ++output->num_results;
+        }
+
+        if (status != BANANA_STATUS_OK) {
+            return SetError(status, "the output buffers are too small for all results");
+        }
+        return status;
+    } catch (std::exception const& ex) {
+        return SetError(BANANA_STATUS_INTERNAL_ERROR, ex.what());
+    } catch (...) {
+        return SetError(BANANA_STATUS_INTERNAL_ERROR, "unknown error");
+    }
+}
+
+char const* banana_get_last_error_message(void) {
+    return last_error_message.c_str();
+}
+
+}
@@ -1,11 +1,20 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <iterator>
 #include <numbers>
 #include <numeric>
+#include <random>
 #include <ranges>
 #include <stdexcept>
+#include <tuple>
 #include <utility>
 
 #include <polyfit/Polynomial2DFit.hpp>
+#include <banana-lib/binary-mask.hpp>
 #include <banana-lib/lib.hpp>
+#include <banana-lib/run-length-mask.hpp>
+#include <banana-lib/stage-cache.hpp>
 
 //#define SHOW_DEBUG_INFO
 
@@ -25,6 +34,17 @@ namespace banana {
 #  define SHOW_DEBUG_IMAGE(image, windowName)
 #endif
 
+    /// Size of the kernel used to remove noise from the detection mask.
+    constexpr int kMorphKernelSize = 5;
+    /// Size of the kernel used to smooth the detection mask.
+    constexpr int kBlurKernelSize = 37;
+    /// How far (in px) the neighbours of a pixel influence its value in the detection mask (erode + dilate + median blur).
+    constexpr int kDetectionMaskReach = 2 * (kMorphKernelSize / 2) + kBlurKernelSize / 2;
+    /// Seed used for the random positions when sampling the ripeness.
+    constexpr std::mt19937::result_type kRipenessSamplingSeed = 42;
+    /// z-score for a two-sided 95% confidence interval.
+    constexpr double kConfidenceIntervalZScore = 1.96;
+
     auto AnalysisError::ToString() const -> std::string {
         switch(value) {
             case kInvalidImage:
@@ -44,13 +64,21 @@ namespace banana {
         o << "found " << analysis_result.banana.size() << " banana(s) in the picture" << std::endl;
         for (auto const& [n, banana] : std::ranges::enumerate_view(analysis_result.banana)) {
             auto const& [coeff_0, coeff_1, coeff_2] = banana.center_line.coefficients;
-            o << "  Banana #" << n << ":" << std::endl;
+            o << "  Banana #" << n;
+            if (banana.zone_id) {
+                o << " (zone " << *banana.zone_id << ")";
+            }
+            o << ":" << std::endl;
             o << "    " << std::format("y = {:.6f} {:+.6f} * x {:+.6f} * x^2", coeff_0, coeff_1, coeff_2) << std::endl;
             o << "    Rotation = " << std::format("{:.2f}", banana.rotation_angle * 180 / std::numbers::pi) << " degrees" << std::endl;
             o << "    Mean curvature = " << std::format("{:.2f}", banana.mean_curvature / 100) << " 1/cm"
               << " (corresponds to a circle with radius = " << std::format("{:.2f}", 1/banana.mean_curvature * 100) << " cm)" << std::endl;
             o << "    Length along center line = " << std::format("{:.2f}", banana.length * 100) << " cm" << std::endl;
-            o << "    ripeness = " << std::format("{:.0f}", banana.ripeness * 100) << " %" << std::endl;
+            o << "    ripeness = " << std::format("{:.0f}", banana.ripeness * 100) << " %";
+            if (banana.ripeness_uncertainty > 0) {
+                o << " (+/- " << std::format("{:.0f}", banana.ripeness_uncertainty * 100) << " %)";
+            }
+            o << std::endl;
             o << std::endl;
         }
 
@@ -64,6 +92,43 @@ namespace banana {
         }
         fs["banana"] >> this->reference_contour_;
         fs.release();
+
+        if (std::ranges::any_of(settings_.inspection_zones, [](auto const& zone) { return zone.polygon.size() < 3; })) {
+            throw std::invalid_argument("the polygon of an inspection zone needs at least three points!");
+        }
+
+        // everything which has an influence on the contours found. kMorphKernelSize & kBlurKernelSize are included
+        // as they're part of the algorithm (changing them would also change the version of the library).
+        this->detection_settings_hash_ = StageHasher{}
+                .Add(static_cast<std::uint64_t>(kMorphKernelSize))
+                .Add(static_cast<std::uint64_t>(kBlurKernelSize))
+                .Add(this->reference_contour_)
+                .Add(static_cast<double>(settings_.match_max_score))
+                .Add(static_cast<double>(settings_.min_area))
+                .Add(static_cast<double>(settings_.max_area))
+                .Add(settings_.filter_lower_threshold_color)
+                .Add(settings_.filter_upper_threshold_color)
+                .Add(static_cast<std::uint64_t>(settings_.inspection_zones.size()))
+                .Get();
+        for (auto const& zone : settings_.inspection_zones) {
+            this->detection_settings_hash_ = StageHasher{}
+                    .Add(this->detection_settings_hash_)
+                    .Add(static_cast<std::uint64_t>(static_cast<std::uint32_t>(zone.id)))
+                    .Add(zone.polygon)
+                    .Get();
+        }
+
+        this->ripeness_settings_hash_ = StageHasher{}
+                .Add(this->detection_settings_hash_)
+                .Add(settings_.green_lower_threshold_color)
+                .Add(settings_.green_upper_threshold_color)
+                .Add(settings_.yellow_lower_threshold_color)
+                .Add(settings_.yellow_upper_threshold_color)
+                .Add(settings_.brown_lower_threshold_color)
+                .Add(settings_.brown_upper_threshold_color)
+                .Add(static_cast<std::uint64_t>(settings_.ripeness_sample_budget))
+                .Add(static_cast<double>(settings_.ripeness_max_uncertainty))
+                .Get();
     }
 
     auto Analyzer::AnalyzeImage(cv::Mat const& image) const -> std::expected<std::list<AnalysisResult>, AnalysisError> {
@@ -71,23 +136,65 @@ namespace banana {
             return std::unexpected{AnalysisError::kInvalidImage};
         }
 
-        auto const contours = this->FindBananaContours(image);
-
         std::list<AnalysisResult> analysis_results;
 
-        for (auto const& contour : contours) {
-            auto const result = this->AnalyzeBanana(image, contour);
+        for (auto const& [zone_id, contours] : this->FindBananaContoursByZone(image)) {
+            for (auto const& contour : contours) {
+                auto result = this->AnalyzeBanana(image, contour);
 
-            if (result) {
-                analysis_results.push_back(result.value());
-            } else {
-                return std::unexpected{result.error()};
+                if (result) {
+                    result->zone_id = zone_id;
+                    analysis_results.push_back(std::move(*result));
+                } else {
+                    return std::unexpected{result.error()};
+                }
             }
         }
 
         return analysis_results;
     }
 
+    auto Analyzer::AnalyzeImage(cv::Mat const& image, StageCache const& cache) const -> std::expected<std::list<AnalysisResult>, AnalysisError> {
+        if (image.data == nullptr) {
+            return std::unexpected{AnalysisError::kInvalidImage};
+        }
+
+        auto const image_hash = StageCache::HashImage(image);
+
+        auto shapes = cache.LoadShapes(image_hash, this->detection_settings_hash_);
+        if (!shapes) {
+            shapes.emplace();
+            for (auto const& [zone_id, contours] : this->FindBananaContoursByZone(image)) {
+                for (auto const& contour : contours) {
+                    auto shape = this->GetBananaShape(contour);
+                    if (!shape) {
+                        return std::unexpected{shape.error()};
+                    }
+                    shape->zone_id = zone_id;
+                    shapes->push_back(std::move(*shape));
+                }
+            }
+            cache.StoreShapes(image_hash, this->detection_settings_hash_, *shapes);
+        }
+
+        auto ripeness = cache.LoadRipeness(image_hash, this->ripeness_settings_hash_);
+        if (!ripeness || ripeness->size() != shapes->size()) {
+            ripeness = *shapes
+                       | std::views::transform([this, &image](auto const& shape) -> RipenessEstimate {
+                           return this->GetBananaRipeness(image, shape.contour);
+                       })
+                       | std::ranges::to<std::vector>();
+            cache.StoreRipeness(image_hash, this->ripeness_settings_hash_, *ripeness);
+        }
+
+        return std::views::zip(*shapes, *ripeness)
+               | std::views::transform([this](auto const& shape_and_ripeness) -> AnalysisResult {
+                   auto const& [shape, banana_ripeness] = shape_and_ripeness;
+                   return this->CompleteBananaAnalysis(shape, banana_ripeness);
+               })
+               | std::ranges::to<std::list>();
+    }
+
     auto Analyzer::AnalyzeAndAnnotateImage(cv::Mat const& image) const -> std::expected<AnnotatedAnalysisResult, AnalysisError> {
         return this->AnalyzeImage(image)
             .and_then([&image, this](auto const& analysis_result) -> std::expected<AnnotatedAnalysisResult, AnalysisError> {
@@ -106,28 +213,181 @@ namespace banana {
     }
 
     auto Analyzer::IsBananaContour(Contour const& contour) const -> bool {
-        if (cv::matchShapes(contour, this->reference_contour_, cv::CONTOURS_MATCH_I1, 0.0) > this->settings_.match_max_score) {
+        // the area is much cheaper to calculate than the shape match, thus check it first
+        auto const area = cv::contourArea(contour);
+        if (area <= settings_.min_area || settings_.max_area <= area) {
             return false;
         }
-        auto const area = cv::contourArea(contour);
-        return settings_.min_area < area && area < settings_.max_area;
+        return cv::matchShapes(contour, this->reference_contour_, cv::CONTOURS_MATCH_I1, 0.0) <= this->settings_.match_max_score;
     }
 
-    auto Analyzer::FindBananaContours(cv::Mat const& image) const -> Contours {
+    auto Analyzer::FindCandidateContours(cv::Mat const& detection_mask) const -> Contours {
+        cv::Mat labels, stats, centroids;
+        // findContours treats the objects as 8-connected, thus each component has exactly one external contour
+        auto const num_labels = cv::connectedComponentsWithStats(detection_mask, labels, stats, centroids, 8, CV_32S);
+
+        // the contour runs through the centres of the outermost pixels, thus its area can't be larger than the box spanned
+        // by them. the pixel count gives no lower bound for the area of the contour (e.g. for thin parts), thus `max_area`
+        // can only be checked once the contour has been traced.
+        std::vector<int> candidates;
+        for (auto label = 1; label < num_labels; ++label) {
+            auto const max_contour_area = static_cast<double>(stats.at<int>(label, cv::CC_STAT_WIDTH) - 1) * (stats.at<int>(label, cv::CC_STAT_HEIGHT) - 1);
+            if (max_contour_area > settings_.min_area) {
+                candidates.push_back(label);
+            }
+        }
+        if (candidates.empty()) {
+            return {};
+        }
+
+        // trace each candidate on its own, only looking at its bounding box. as the components don't touch each other
+        // the contour is identical to the one traced on the whole mask.
+        std::vector<cv::Rect> bounds(candidates.size());
+        Contours contours(candidates.size());
+        cv::parallel_for_(cv::Range{0, static_cast<int>(candidates.size())}, [&](cv::Range const& range) {
+            for (auto i = range.start; i < range.end; ++i) {
+                auto const label = candidates[i];
+                bounds[i] = cv::Rect{
+                    stats.at<int>(label, cv::CC_STAT_LEFT), stats.at<int>(label, cv::CC_STAT_TOP),
+                    stats.at<int>(label, cv::CC_STAT_WIDTH), stats.at<int>(label, cv::CC_STAT_HEIGHT),
+                };
+                cv::Mat const component_mask = labels(bounds[i]) == label;
+
+                Contours component_contours;
+                cv::findContours(component_mask, component_contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, bounds[i].tl());
+                contours[i] = std::move(component_contours.front());
+            }
+        });
+
+        // a component lying in a hole of another component has no external contour in the whole mask. if the enclosing
+        // component has been rejected above this one has been rejected as well, as it is smaller.
+        auto const is_in_hole = std::views::iota(0uz, contours.size())
+                                | std::views::transform([&](auto const i) -> bool {
+                                    return std::ranges::any_of(std::views::iota(0uz, contours.size()), [&](auto const j) {
+                                        return i != j
+                                            && (bounds[i] & bounds[j]) == bounds[i]
+                                            && cv::pointPolygonTest(contours[j], contours[i].front(), false) > 0;
+                                    });
+                                })
+                                | std::ranges::to<std::vector>();
+        for (auto const i : std::views::iota(0uz, contours.size()) | std::views::reverse) {
+            if (is_in_hole[i]) {
+                contours.erase(contours.begin() + static_cast<std::ptrdiff_t>(i));
+            }
+        }
+        return contours;
+    }
+
+    auto Analyzer::CreateDetectionMask(cv::Mat const& image) const -> cv::Mat {
         auto filtered_image = ColorFilter(image, settings_.filter_lower_threshold_color, settings_.filter_upper_threshold_color);
         SHOW_DEBUG_IMAGE(filtered_image, "color filtered image");
 
+        if (settings_.bit_packed_detection_mask) {
+            // same operations as below: on a binary image the median is the majority
+            auto const smoothed_mask = BinaryMask::FromMat(filtered_image).Open(kMorphKernelSize).MajorityFilter(kBlurKernelSize).ToMat();
+            SHOW_DEBUG_IMAGE(smoothed_mask, "blur");
+            return smoothed_mask;
+        }
+
         // Removing noise
-        auto const kernel = cv::getStructuringElement(cv::MORPH_RECT, {5, 5});
+        auto const kernel = cv::getStructuringElement(cv::MORPH_RECT, {kMorphKernelSize, kMorphKernelSize});
         cv::morphologyEx(filtered_image, filtered_image, cv::MORPH_OPEN, kernel);
         SHOW_DEBUG_IMAGE(filtered_image, "morph");
 
         // Smooth the image
-        cv::medianBlur(filtered_image, filtered_image, 37);
+        cv::medianBlur(filtered_image, filtered_image, kBlurKernelSize);
         SHOW_DEBUG_IMAGE(filtered_image, "blur");
 
+        return filtered_image;
+    }
+
+    auto Analyzer::CreateDetectionMask(cv::Mat const& image, cv::Rect const& region) const -> cv::Mat {
+        // the pixels at the border of the padded region are not identical to the mask of the whole image,
+        // but they're too far away to have an influence on the pixels of the region itself.
+        auto const padded_region = cv::Rect{
+            region.x - kDetectionMaskReach, region.y - kDetectionMaskReach,
+            region.width + 2 * kDetectionMaskReach, region.height + 2 * kDetectionMaskReach,
+        } & cv::Rect{{0, 0}, image.size()};
+
+        auto const padded_mask = this->CreateDetectionMask(image(padded_region));
+        return padded_mask(region - padded_region.tl());
+    }
+
+    auto Analyzer::FindContoursInBands(cv::Mat const& image) const -> Contours {
+        auto const band_height = settings_.detection_band_height;
+        auto const num_bands = (image.rows + band_height - 1) / band_height;
+
+        /// Whether the object touches a border between two bands, i.e. if it might continue in the neighbouring band.
+        auto const is_cut_off = [&image](cv::Rect const& bounds, cv::Rect const& band_rect) -> bool {
+            return (bounds.y == band_rect.y && band_rect.y > 0)
+                || (bounds.br().y == band_rect.br().y && band_rect.br().y < image.rows);
+        };
+
+        // objects which lie completely within their band are final, the others are kept as runs to be stitched together
+        std::vector<Contours> complete_contours(num_bands);
+        std::vector<std::vector<PixelRun>> cut_off_runs(num_bands);
+        cv::parallel_for_(cv::Range{0, num_bands}, [&](cv::Range const& range) {
+            for (auto band = range.start; band < range.end; ++band) {
+                cv::Rect const band_rect{0, band * band_height, image.cols, std::min(band_height, image.rows - band * band_height)};
+                auto const mask = this->CreateDetectionMask(image, band_rect);
+
+                Contours contours;
+                cv::findContours(mask, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE, band_rect.tl());
+                auto has_cut_off_objects = false;
+                for (auto& contour : contours) {
+                    if (is_cut_off(cv::boundingRect(contour), band_rect)) {
+                        has_cut_off_objects = true;
+                    } else {
+                        complete_contours[band].push_back(std::move(contour));
+                    }
+                }
+                if (!has_cut_off_objects) {
+                    continue;
+                }
+
+                // the runs only need memory along the rows of the objects, not for the area of the band or of the objects
+                for (auto const& object : RunLengthMask::FromMat(mask, band_rect.tl()).SplitComponents()) {
+                    if (is_cut_off(object.GetBounds(), band_rect)) {
+                        std::ranges::copy(object.GetRuns(), std::back_inserter(cut_off_runs[band]));
+                    }
+                }
+            }
+        });
+
+        // the parts of an object spanning several bands touch each other at the band borders, thus they're joined into
+        // one component. only the runs of the parts are needed for this, not a mask of the region covered by the object.
+        auto const stitched_objects = RunLengthMask{cut_off_runs | std::views::join | std::ranges::to<std::vector>()}.SplitComponents();
+        Contours stitched_contours(stitched_objects.size());
+        cv::parallel_for_(cv::Range{0, static_cast<int>(stitched_objects.size())}, [&](cv::Range const& range) {
+            for (auto i = range.start; i < range.end; ++i) {
+                stitched_contours[i] = stitched_objects[i].TraceExternalContour();
+            }
+        });
+
+        // an object lying in a hole of a stitched object has no external contour in the whole mask
+        auto const is_in_hole = [&](Contour const& contour) -> bool {
+            auto const bounds = cv::boundingRect(contour);
+            return std::ranges::any_of(std::views::iota(0uz, stitched_objects.size()), [&](auto const i) {
+                return (bounds & stitched_objects[i].GetBounds()) == bounds
+                    && cv::pointPolygonTest(stitched_contours[i], contour.front(), false) > 0;
+            });
+        };
+
+        auto contours = complete_contours
+                        | std::views::join
+                        | std::views::filter([&](auto const& contour) { return !is_in_hole(contour); })
+                        | std::ranges::to<Contours>();
+        std::ranges::copy_if(stitched_contours, std::back_inserter(contours), [&](auto const& contour) { return !is_in_hole(contour); });
+        return contours;
+    }
+
+    auto Analyzer::FindBananaContours(cv::Mat const& image) const -> Contours {
         Contours contours;
-        cv::findContours(filtered_image, contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        if (settings_.detection_band_height > 0 && image.rows > settings_.detection_band_height) {
+            contours = this->FindContoursInBands(image);
+        } else {
+            contours = this->FindCandidateContours(this->CreateDetectionMask(image));
+        }
 
         std::erase_if(contours, [this](auto const& contour) -> auto {
             return !this->IsBananaContour(contour);
@@ -136,6 +396,47 @@ namespace banana {
         return contours;
     }
 
+    auto Analyzer::FindBananaContoursInZone(cv::Mat const& image, InspectionZone const& zone) const -> Contours {
+        auto const bounds = cv::boundingRect(zone.polygon) & cv::Rect{{0, 0}, image.size()};
+        if (bounds.empty()) {
+            return {};
+        }
+
+        auto detection_mask = this->CreateDetectionMask(image(bounds));
+
+        // objects are cut off at the border of the zone
+        cv::Mat zone_mask{bounds.size(), CV_8UC1, cv::Scalar{0}};
+        cv::fillPoly(zone_mask, std::vector{{zone.polygon}}, cv::Scalar{255}, cv::LINE_8, 0, -bounds.tl());
+        cv::bitwise_and(detection_mask, zone_mask, detection_mask);
+
+        auto contours = this->FindCandidateContours(detection_mask);
+        std::erase_if(contours, [this](auto const& contour) -> auto {
+            return !this->IsBananaContour(contour);
+        });
+        for (auto& contour : contours) {
+            for (auto& point : contour) {
+                point += bounds.tl();
+            }
+        }
+
+        return contours;
+    }
+
+    auto Analyzer::FindBananaContoursByZone(cv::Mat const& image) const -> std::vector<ZoneContours> {
+        auto const& zones = settings_.inspection_zones;
+        if (zones.empty()) {
+            return {{.zone_id = std::nullopt, .contours = this->FindBananaContours(image)}};
+        }
+
+        std::vector<ZoneContours> zone_contours(zones.size());
+        cv::parallel_for_(cv::Range{0, static_cast<int>(zones.size())}, [&](cv::Range const& range) {
+            for (auto i = range.start; i < range.end; ++i) {
+                zone_contours[i] = {.zone_id = zones[i].id, .contours = this->FindBananaContoursInZone(image, zones[i])};
+            }
+        });
+        return zone_contours;
+    }
+
     auto Analyzer::GetBananaCenterLineCoefficients(Contour const& rotated_banana_contour) const -> std::expected<Polynomial2DCoefficients, AnalysisError> {
         auto const to_std_pair_fn = [](auto const& p) -> std::pair<double, double> { return {p.x, p.y}; };
         auto const coeffs = polyfit::Fit2DPolynomial(rotated_banana_contour | std::views::transform(to_std_pair_fn));
@@ -241,11 +542,13 @@ namespace banana {
     }
 
     auto Analyzer::GetMaskedImage(const cv::Mat& image, const Contour& contour) const -> cv::Mat {
-        auto mask = cv::Mat{image.size(), CV_8UC3, cv::Scalar{255,255,255}};
-        cv::drawContours(mask, std::vector{{contour}}, -1, {0,0,0}, cv::FILLED);
+        // only the part of the image around the contour is needed, which is a lot smaller than the whole image
+        auto const bounds = cv::boundingRect(contour);
+        auto mask = cv::Mat{bounds.size(), CV_8UC3, cv::Scalar{255,255,255}};
+        cv::drawContours(mask, std::vector{{contour}}, -1, {0,0,0}, cv::FILLED, cv::LINE_8, cv::noArray(), INT_MAX, -bounds.tl());
         SHOW_DEBUG_IMAGE(mask, "mask");
         cv::Mat masked;
-        cv::bitwise_or(image, mask, masked);
+        cv::bitwise_or(image(bounds), mask, masked);
         SHOW_DEBUG_IMAGE(masked, "filtered image (masked area only)");
         return masked;
     }
@@ -270,7 +573,141 @@ namespace banana {
         return 1 - green_share + brown_share;
     }
 
+    auto Analyzer::GetContourRowSpans(Contour const& contour, cv::Rect const& bounds) const -> RowSpans {
+        RowSpans spans(static_cast<std::size_t>(bounds.height));
+        // x positions at which the edges of the contour cross each row
+        std::vector<std::vector<double>> crossings(static_cast<std::size_t>(bounds.height));
+        for (std::size_t i = 0; i < contour.size(); ++i) {
+            auto const& p0 = contour[i];
+            auto const& p1 = contour[(i + 1) % contour.size()];
+            // the border belongs to the contour. this also covers the vertices at the bottom of the contour, which the
+            // crossings below miss
+            auto& border_spans = spans[p0.y - bounds.y];
+            if (p0.y == p1.y) {
+                border_spans.emplace_back(std::min(p0.x, p1.x), std::max(p0.x, p1.x) + 1);
+                continue;
+            }
+            border_spans.emplace_back(p0.x, p0.x + 1);
+
+            // half-open in y so that a vertex shared by two edges only counts once (unless both edges start there)
+            auto const& [top, bottom] = p0.y < p1.y ? std::tie(p0, p1) : std::tie(p1, p0);
+            for (auto y = top.y; y < bottom.y; ++y) {
+                crossings[y - bounds.y].push_back(top.x + static_cast<double>((y - top.y) * (bottom.x - top.x)) / (bottom.y - top.y));
+            }
+        }
+
+        // even-odd rule: the pixels between each pair of crossings are inside
+        for (auto&& [row_crossings, row_spans] : std::views::zip(crossings, spans)) {
+            std::ranges::sort(row_crossings);
+            for (std::size_t i = 0; i + 1 < row_crossings.size(); i += 2) {
+                row_spans.emplace_back(static_cast<int>(std::ceil(row_crossings[i])), static_cast<int>(std::floor(row_crossings[i + 1])) + 1);
+            }
+        }
+        return spans;
+    }
+
+    auto Analyzer::SampleBananaRipeness(cv::Mat const& image, Contour const& banana_contour) const -> std::optional<RipenessEstimate> {
+        auto const bounds = cv::boundingRect(banana_contour);
+        auto const row_spans = this->GetContourRowSpans(banana_contour, bounds);
+        auto const is_inside = [&](cv::Point const& position) -> bool {
+            return std::ranges::any_of(row_spans[position.y - bounds.y], [&](cv::Range const& span) { return span.start <= position.x && position.x < span.end; });
+        };
+
+        // stratified sampling: split the bounding box into a grid with (roughly) one cell per sample and pick one random
+        // position within each cell. this spreads the samples over the whole banana, which lowers the variance.
+        auto const budget = static_cast<double>(settings_.ripeness_sample_budget);
+        auto const cells_x = std::clamp(static_cast<int>(std::round(std::sqrt(budget * bounds.width / bounds.height))), 1, bounds.width);
+        auto const cells_y = std::clamp(static_cast<int>(budget / cells_x), 1, bounds.height);
+
+        // a fixed seed keeps the results reproducible (and thus cacheable)
+        std::mt19937 generator{kRipenessSamplingSeed};
+        std::vector<cv::Vec3b> samples;
+        samples.reserve(static_cast<std::size_t>(cells_x) * cells_y);
+        for (auto cell_y = 0; cell_y < cells_y; ++cell_y) {
+            std::uniform_int_distribution<int> y_distribution{bounds.y + cell_y * bounds.height / cells_y, bounds.y + (cell_y + 1) * bounds.height / cells_y - 1};
+            for (auto cell_x = 0; cell_x < cells_x; ++cell_x) {
+                std::uniform_int_distribution<int> x_distribution{bounds.x + cell_x * bounds.width / cells_x, bounds.x + (cell_x + 1) * bounds.width / cells_x - 1};
+                cv::Point const position{x_distribution(generator), y_distribution(generator)};
+                if (is_inside(position)) {
+                    samples.push_back(image.at<cv::Vec3b>(position));
+                }
+            }
+        }
+
+        if (samples.size() < 2) {
+            return std::nullopt;
+        }
+
+        cv::Mat hsv_samples;
+        cv::cvtColor(cv::Mat{samples}.reshape(3, 1), hsv_samples, cv::COLOR_BGR2HSV);
+
+        auto const is_in_range = [](cv::Vec3b const& pixel, cv::Scalar const& low, cv::Scalar const& up) -> bool {
+            return std::ranges::all_of(std::views::iota(0, 3), [&](auto const c) { return low[c] <= pixel[c] && pixel[c] <= up[c]; });
+        };
+
+        // the ripeness is 1 + (brown - green) / (green + yellow + brown), i.e. a ratio of two sums over the pixels.
+        // per sample: z = brown - green, w = green + yellow + brown (each being 0 or 1).
+        std::vector<std::pair<double, double>> z_w;
+        z_w.reserve(samples.size());
+        for (auto const& pixel : cv::Mat_<cv::Vec3b>{hsv_samples}) {
+            auto const green = is_in_range(pixel, settings_.green_lower_threshold_color, settings_.green_upper_threshold_color) ? 1.0 : 0.0;
+            auto const yellow = is_in_range(pixel, settings_.yellow_lower_threshold_color, settings_.yellow_upper_threshold_color) ? 1.0 : 0.0;
+            auto const brown = is_in_range(pixel, settings_.brown_lower_threshold_color, settings_.brown_upper_threshold_color) ? 1.0 : 0.0;
+            z_w.emplace_back(brown - green, green + yellow + brown);
+        }
+
+        auto const n = static_cast<double>(z_w.size());
+        auto const sum_z = std::accumulate(z_w.cbegin(), z_w.cend(), 0.0, [](auto const acc, auto const& p) { return acc + p.first; });
+        auto const sum_w = std::accumulate(z_w.cbegin(), z_w.cend(), 0.0, [](auto const acc, auto const& p) { return acc + p.second; });
+        if (sum_w == 0) {
+            return std::nullopt;
+        }
+        auto const ratio = sum_z / sum_w;
+
+        // variance of a ratio estimator (delta method): Var(R) ~ s^2 / (n * mean(w)^2) with s^2 the variance of the residuals z - R * w.
+        // this ignores the stratification and the finite number of pixels, both of which only make the real variance smaller.
+        auto const sum_squared_residuals = std::accumulate(z_w.cbegin(), z_w.cend(), 0.0, [ratio](auto const acc, auto const& p) {
+            auto const residual = p.first - ratio * p.second;
+            return acc + residual * residual;
+        });
+        auto const mean_w = sum_w / n;
+        auto const variance = sum_squared_residuals / (n - 1) / (n * mean_w * mean_w);
+
+        return RipenessEstimate{
+            .ripeness = static_cast<float>(1 + ratio),
+            .uncertainty = static_cast<float>(kConfidenceIntervalZScore * std::sqrt(variance)),
+        };
+    }
+
+    auto Analyzer::GetBananaRipeness(cv::Mat const& image, Contour const& banana_contour) const -> RipenessEstimate {
+        if (settings_.ripeness_sample_budget > 0) {
+            auto const estimate = this->SampleBananaRipeness(image, banana_contour);
+            if (estimate && estimate->uncertainty <= settings_.ripeness_max_uncertainty) {
+                return *estimate;
+            }
+        }
+
+        return {
+            .ripeness = this->IdentifyBananaRipeness(this->GetMaskedImage(image, banana_contour)),
+            .uncertainty = 0,
+        };
+    }
+
     auto Analyzer::AnalyzeBanana(cv::Mat const& image, Contour const& banana_contour) const -> std::expected<AnalysisResult, AnalysisError> {
+        return this->GetBananaShape(banana_contour)
+            .transform([this, &image, &banana_contour](auto const& shape) -> AnalysisResult {
+                return this->CompleteBananaAnalysis(shape, this->GetBananaRipeness(image, banana_contour));
+            });
+    }
+
+    auto Analyzer::AnalyzeBananaContour(Contour const& banana_contour, float const ripeness) const -> std::expected<AnalysisResult, AnalysisError> {
+        return this->GetBananaShape(banana_contour)
+            .transform([this, ripeness](auto const& shape) -> AnalysisResult {
+                return this->CompleteBananaAnalysis(shape, {.ripeness = ripeness, .uncertainty = 0});
+            });
+    }
+
+    auto Analyzer::GetBananaShape(Contour const& banana_contour) const -> std::expected<BananaShape, AnalysisError> {
         auto const pca = this->GetPCA(banana_contour);
 
         // rotate the contour so that it's horizontal
@@ -281,21 +718,33 @@ namespace banana {
             return std::unexpected{coeffs.error()};
         }
 
-        AnalysisResult::CenterLine const center_line{
-                .coefficients = *coeffs,
-                .points_in_banana_coordsys = this->GetBananaCenterLine(rotated_contour, *coeffs),
+        return BananaShape{
+                .contour = banana_contour,
+                .rotation_angle = pca.angle,
+                .estimated_center = pca.center,
+                .center_line_coefficients = *coeffs,
         };
+    }
 
-        auto const banana_only = this->GetMaskedImage(image, banana_contour);
+    auto Analyzer::CompleteBananaAnalysis(BananaShape const& shape, RipenessEstimate const& ripeness) const -> AnalysisResult {
+        // rotating the contour again is cheap compared to fitting the center line and saves storing it in the shape
+        auto const rotated_contour = this->RotateContour(shape.contour, shape.estimated_center, shape.rotation_angle);
+
+        AnalysisResult::CenterLine const center_line{
+                .coefficients = shape.center_line_coefficients,
+                .points_in_banana_coordsys = this->GetBananaCenterLine(rotated_contour, shape.center_line_coefficients),
+        };
 
         return AnalysisResult{
-                .contour = banana_contour,
+                .contour = shape.contour,
                 .center_line = center_line,
-                .rotation_angle = pca.angle,
-                .estimated_center = pca.center,
+                .rotation_angle = shape.rotation_angle,
+                .estimated_center = shape.estimated_center,
                 .mean_curvature = this->CalculateMeanCurvature(center_line),
                 .length = this->CalculateBananaLength(center_line),
-                .ripeness = this->IdentifyBananaRipeness(banana_only),
+                .ripeness = ripeness.ripeness,
+                .ripeness_uncertainty = ripeness.uncertainty,
+                .zone_id = shape.zone_id,
         };
     }
 
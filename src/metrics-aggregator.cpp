@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <banana-lib/metrics-aggregator.hpp>
+
+namespace banana {
+
+    auto MetricSummary::Quantile(double const q) const -> double {
+        // not `count`, a snapshot taken while results are being added may differ slightly from the histogram
+        auto const total = std::accumulate(histogram.cbegin(), histogram.cend(), std::uint64_t{0});
+        if (total == 0) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        auto const bin_width = (range.upper - range.lower) / static_cast<double>(histogram.size());
+        auto const rank = std::clamp(q, 0.0, 1.0) * static_cast<double>(total);
+        double cumulative = 0;
+        for (std::size_t bin = 0; bin < histogram.size(); ++bin) {
+            auto const bin_count = static_cast<double>(histogram[bin]);
+            if (bin_count > 0 && cumulative + bin_count >= rank) {
+                // assume the values to be spread evenly within the bin
+                return range.lower + (static_cast<double>(bin) + (rank - cumulative) / bin_count) * bin_width;
+            }
+            cumulative += bin_count;
+        }
+        return range.upper;
+    }
+
+    MetricsAggregator::MetricsAggregator(Settings settings) : settings_(std::move(settings)) {
+        if (settings_.num_buckets == 0 || settings_.bucket_duration <= Clock::duration::zero()) {
+            throw std::invalid_argument("the window needs at least one bucket with a positive duration!");
+        }
+        for (auto const& range : {settings_.ripeness_range, settings_.length_range, settings_.mean_curvature_range}) {
+            if (!(range.lower < range.upper)) {
+                throw std::invalid_argument("the upper bound of a histogram must be larger than its lower bound!");
+            }
+        }
+        buckets_ = std::make_unique<Bucket[]>(settings_.num_buckets);
+    }
+
+    void MetricsAggregator::AddFrame(std::list<AnalysisResult> const& results, Clock::time_point const timestamp) {
+        auto* const bucket = this->AcquireBucket(this->GetPeriod(timestamp));
+        if (bucket == nullptr) {
+            return;
+        }
+
+        bucket->frames.fetch_add(1, std::memory_order_relaxed);
+        for (auto const& result : results) {
+            AddValue(bucket->ripeness, settings_.ripeness_range, result.ripeness);
+            AddValue(bucket->length, settings_.length_range, result.length);
+            AddValue(bucket->mean_curvature, settings_.mean_curvature_range, result.mean_curvature);
+        }
+        ReleaseBucket(*bucket);
+    }
+
+    auto MetricsAggregator::Snapshot(Clock::time_point const timestamp) const -> MetricsSnapshot {
+        auto const current_period = this->GetPeriod(timestamp);
+        auto const num_buckets = static_cast<std::int64_t>(settings_.num_buckets);
+
+        std::vector<Bucket const*> buckets;
+        for (std::size_t i = 0; i < settings_.num_buckets; ++i) {
+            auto const period = buckets_[i].period.load(std::memory_order_acquire);
+            if (period > current_period - num_buckets && period <= current_period) {
+                buckets.push_back(&buckets_[i]);
+            }
+        }
+
+        std::uint64_t frames = 0;
+        for (auto const* bucket : buckets) {
+            frames += bucket->frames.load(std::memory_order_relaxed);
+        }
+        return {
+            .frames = frames,
+            .ripeness = Summarize(buckets, &Bucket::ripeness, settings_.ripeness_range),
+            .length = Summarize(buckets, &Bucket::length, settings_.length_range),
+            .mean_curvature = Summarize(buckets, &Bucket::mean_curvature, settings_.mean_curvature_range),
+        };
+    }
+
+    auto MetricsAggregator::GetPeriod(Clock::time_point const timestamp) const -> std::int64_t {
+        return static_cast<std::int64_t>(timestamp.time_since_epoch() / settings_.bucket_duration);
+    }
+
+    auto MetricsAggregator::AcquireBucket(std::int64_t const period) -> Bucket* {
+        auto& bucket = buckets_[static_cast<std::size_t>(period) % settings_.num_buckets];
+        auto bucket_period = bucket.period.load(std::memory_order_acquire);
+        while (true) {
+            if (bucket_period == period) {
+                // pin first, then check that the bucket hasn't been taken over for a newer period in the meantime. the
+                // thread clearing it checks the writers only after changing the period, thus (with seq_cst) at least one
+                // of both sees the other.
+                bucket.writers.fetch_add(1, std::memory_order_seq_cst);
+                if (bucket.period.load(std::memory_order_seq_cst) == period) {
+                    return &bucket;
+                }
+                ReleaseBucket(bucket);
+                bucket_period = bucket.period.load(std::memory_order_acquire);
+            } else if (bucket_period == kClearing) {
+                // another thread is clearing the bucket for a new period, which only takes a moment
+                std::this_thread::yield();
+                bucket_period = bucket.period.load(std::memory_order_acquire);
+            } else if (bucket_period > period) {
+                return nullptr;
+            } else if (bucket.period.compare_exchange_weak(bucket_period, kClearing, std::memory_order_seq_cst)) {
+                // results of the old period which are still being added must neither be lost nor end up in the new one
+                while (bucket.writers.load(std::memory_order_seq_cst) != 0) {
+                    std::this_thread::yield();
+                }
+                bucket.frames.store(0, std::memory_order_relaxed);
+                for (auto* const counters : {&bucket.ripeness, &bucket.length, &bucket.mean_curvature}) {
+                    counters->count.store(0, std::memory_order_relaxed);
+                    counters->non_finite_count.store(0, std::memory_order_relaxed);
+                    counters->sum.store(0, std::memory_order_relaxed);
+                    counters->sum_of_squares.store(0, std::memory_order_relaxed);
+                    for (auto& bin : counters->histogram) {
+                        bin.store(0, std::memory_order_relaxed);
+                    }
+                }
+                bucket.writers.fetch_add(1, std::memory_order_relaxed);
+                bucket.period.store(period, std::memory_order_release);
+                return &bucket;
+            }
+        }
+    }
+
+    void MetricsAggregator::ReleaseBucket(Bucket& bucket) {
+        // release: everything added to the bucket is complete before it can be cleared
+        bucket.writers.fetch_sub(1, std::memory_order_release);
+    }
+
+    void MetricsAggregator::AddValue(MetricCounters& counters, HistogramRange const& range, double const value) {
+        if (!std::isfinite(value)) {
+            // would spoil the sums and can't be sorted into a bin
+            counters.non_finite_count.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        counters.count.fetch_add(1, std::memory_order_relaxed);
+        counters.sum.fetch_add(value, std::memory_order_relaxed);
+        counters.sum_of_squares.fetch_add(value * value, std::memory_order_relaxed);
+
+        auto const relative_value = (value - range.lower) / (range.upper - range.lower);
+        auto const bin = static_cast<std::size_t>(std::clamp(relative_value * kHistogramBins, 0.0, kHistogramBins - 1.0));
+        counters.histogram[bin].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    auto MetricsAggregator::Summarize(std::vector<Bucket const*> const& buckets, MetricCounters Bucket::* const metric, HistogramRange const& range) -> MetricSummary {
+        std::uint64_t count = 0;
+        std::uint64_t non_finite_count = 0;
+        double sum = 0;
+        double sum_of_squares = 0;
+        std::vector<std::uint64_t> histogram(kHistogramBins, 0);
+        for (auto const* bucket : buckets) {
+            auto const& counters = bucket->*metric;
+            count += counters.count.load(std::memory_order_relaxed);
+            non_finite_count += counters.non_finite_count.load(std::memory_order_relaxed);
+            sum += counters.sum.load(std::memory_order_relaxed);
+            sum_of_squares += counters.sum_of_squares.load(std::memory_order_relaxed);
+            for (std::size_t bin = 0; bin < kHistogramBins; ++bin) {
+                histogram[bin] += counters.histogram[bin].load(std::memory_order_relaxed);
+            }
+        }
+
+        auto const n = static_cast<double>(count);
+        auto const nan = std::numeric_limits<double>::quiet_NaN();
+        return {
+            .count = count,
+            .non_finite_count = non_finite_count,
+            .mean = count > 0 ? sum / n : nan,
+            // the rounding errors can make it slightly negative if all values are (almost) the same
+            .variance = count > 1 ? std::max(0.0, (sum_of_squares - sum * sum / n) / (n - 1)) : nan,
+            .range = range,
+            .histogram = std::move(histogram),
+        };
+    }
+
+}
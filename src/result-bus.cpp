@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cstring>
+#include <ranges>
+#include <stdexcept>
+
+#include <banana-lib/result-bus.hpp>
+
+namespace banana {
+
+    namespace {
+        auto ToPublishedBanana(AnalysisResult const& result) -> PublishedBanana {
+            auto const bounding_box = cv::boundingRect(result.contour);
+            return {
+                .bounding_box = {bounding_box.x, bounding_box.y, bounding_box.width, bounding_box.height},
+                .estimated_center = {result.estimated_center.x, result.estimated_center.y},
+                .rotation_angle = result.rotation_angle,
+                .mean_curvature = result.mean_curvature,
+                .length = result.length,
+                .ripeness = result.ripeness,
+                .ripeness_uncertainty = result.ripeness_uncertainty,
+                .zone_id = result.zone_id.value_or(-1),
+            };
+        }
+
+        /// Sequence number of the oldest frame which hasn't been overwritten yet (or of the first frame if there is none).
+        auto GetOldestSequence(ResultBus const& bus) -> std::uint64_t {
+            auto const published_frames = bus.GetPublishedFrames();
+            return published_frames - std::min<std::uint64_t>(published_frames, bus.GetCapacity());
+        }
+    }
+
+    ResultBus::Subscriber::Subscriber(ResultBus const& bus) : bus_(bus), next_sequence_(GetOldestSequence(bus)) {
+    }
+
+    auto ResultBus::Subscriber::Poll() -> std::optional<PublishedFrame> {
+        while (true) {
+            auto const frame = bus_.Read(next_sequence_);
+            if (frame) {
+                ++next_sequence_;
+                return *frame;
+            }
+            if (frame.error() == ReadError::kNotYetPublished) {
+                return std::nullopt;
+            }
+
+            // continue with the oldest frame which is still available (which may be overwritten as well until it's read)
+            auto const next_sequence = std::max(GetOldestSequence(bus_), next_sequence_ + 1);
+            missed_frames_ += next_sequence - next_sequence_;
+            next_sequence_ = next_sequence;
+        }
+    }
+
+    auto ResultBus::Subscriber::GetMissedFrames() const -> std::uint64_t {
+        return missed_frames_;
+    }
+
+    ResultBus::ResultBus(std::size_t const capacity) : capacity_(capacity) {
+        if (capacity_ == 0) {
+            throw std::invalid_argument("the bus needs space for at least one frame!");
+        }
+        slots_ = std::make_unique<Slot[]>(capacity_);
+    }
+
+    auto ResultBus::Publish(std::list<AnalysisResult> const& results, Clock::time_point const captured_at) -> std::uint64_t {
+        auto const sequence = published_frames_.load(std::memory_order_relaxed);
+
+        PublishedFrame frame{
+            .sequence = sequence,
+            .captured_at_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(captured_at.time_since_epoch()).count(),
+            .num_bananas = results.size(),
+            .bananas = {},
+        };
+        for (auto const& [result, banana] : std::views::zip(results, frame.bananas)) {
+            banana = ToPublishedBanana(result);
+        }
+        std::array<std::uint64_t, kFrameWords> words;
+        std::memcpy(words.data(), &frame, sizeof(frame));
+
+        auto& slot = slots_[sequence % capacity_];
+        slot.stamp.store(2 * sequence + 1, std::memory_order_relaxed);
+        // the stamp marking the slot as being written must be visible before any of the new words
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kFrameWords; ++i) {
+            slot.words[i].store(words[i], std::memory_order_relaxed);
+        }
+        slot.stamp.store(2 * sequence + 2, std::memory_order_release);
+
+        published_frames_.store(sequence + 1, std::memory_order_release);
+        return sequence;
+    }
+
+    auto ResultBus::ReadLatest() const -> std::optional<PublishedFrame> {
+        while (true) {
+            auto const published_frames = this->GetPublishedFrames();
+            if (published_frames == 0) {
+                return std::nullopt;
+            }
+            auto const frame = this->Read(published_frames - 1);
+            if (frame) {
+                return *frame;
+            }
+            // overwritten while reading it, thus there is a newer frame now
+        }
+    }
+
+    auto ResultBus::Read(std::uint64_t const sequence) const -> std::expected<PublishedFrame, ReadError> {
+        if (sequence >= this->GetPublishedFrames()) {
+            return std::unexpected{ReadError::kNotYetPublished};
+        }
+
+        auto const& slot = slots_[sequence % capacity_];
+        auto const expected_stamp = 2 * sequence + 2;
+        if (slot.stamp.load(std::memory_order_acquire) != expected_stamp) {
+            return std::unexpected{ReadError::kOverwritten};
+        }
+
+        std::array<std::uint64_t, kFrameWords> words;
+        for (std::size_t i = 0; i < kFrameWords; ++i) {
+            words[i] = slot.words[i].load(std::memory_order_relaxed);
+        }
+        // the words must have been read before checking that the writer didn't start to overwrite them in the meantime
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.stamp.load(std::memory_order_relaxed) != expected_stamp) {
+            return std::unexpected{ReadError::kOverwritten};
+        }
+
+        PublishedFrame frame;
+        std::memcpy(&frame, words.data(), sizeof(frame));
+        return frame;
+    }
+
+    auto ResultBus::GetPublishedFrames() const -> std::uint64_t {
+        return published_frames_.load(std::memory_order_acquire);
+    }
+
+    auto ResultBus::GetCapacity() const -> std::size_t {
+        return capacity_;
+    }
+
+}
@@ -0,0 +1,188 @@
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <numeric>
+#include <utility>
+
+#include <banana-lib/run-length-mask.hpp>
+
+namespace banana {
+
+    namespace {
+        /**
+         * Offsets to the 8 neighbours of a pixel, counter-clockwise starting with the right one. These are the chain codes
+         * used by `cv::findContours`, which the tracing has to follow exactly to produce the same contours.
+         */
+        std::array<cv::Point, 8> const kNeighbourOffsets{{{1, 0}, {1, -1}, {0, -1}, {-1, -1}, {-1, 0}, {-1, 1}, {0, 1}, {1, 1}}};
+
+        /// Find the representative of the set of `i` (with path halving).
+        auto FindRoot(std::vector<std::size_t>& parents, std::size_t i) -> std::size_t {
+            while (parents[i] != i) {
+                parents[i] = parents[parents[i]];
+                i = parents[i];
+            }
+            return i;
+        }
+    }
+
+    RunLengthMask::RunLengthMask(std::vector<PixelRun> runs) {
+        std::ranges::sort(runs);
+        // adjacent runs are joined, thus runs in the same row are always separated by at least one pixel
+        for (auto const& run : runs) {
+            if (!runs_.empty() && runs_.back().y == run.y && runs_.back().x_end >= run.x_begin) {
+                runs_.back().x_end = std::max(runs_.back().x_end, run.x_end);
+            } else {
+                runs_.push_back(run);
+            }
+        }
+        if (runs_.empty()) {
+            return;
+        }
+
+        auto const x_begin = std::ranges::min(runs_, {}, &PixelRun::x_begin).x_begin;
+        auto const x_end = std::ranges::max(runs_, {}, &PixelRun::x_end).x_end;
+        bounds_ = {x_begin, runs_.front().y, x_end - x_begin, runs_.back().y - runs_.front().y + 1};
+
+        row_starts_.reserve(static_cast<std::size_t>(bounds_.height) + 1);
+        std::size_t run = 0;
+        for (auto y = bounds_.y; y < bounds_.br().y; ++y) {
+            row_starts_.push_back(run);
+            while (run < runs_.size() && runs_[run].y == y) {
+                ++run;
+            }
+        }
+        row_starts_.push_back(runs_.size());
+    }
+
+    auto RunLengthMask::FromMat(cv::Mat const& mask, cv::Point const offset) -> RunLengthMask {
+        std::vector<PixelRun> runs;
+        for (auto y = 0; y < mask.rows; ++y) {
+            auto const* const row = mask.ptr<std::uint8_t>(y);
+            for (auto x = 0; x < mask.cols;) {
+                if (row[x] == 0) {
+                    ++x;
+                    continue;
+                }
+                auto const x_begin = x;
+                while (x < mask.cols && row[x] != 0) {
+                    ++x;
+                }
+                runs.push_back({.y = y + offset.y, .x_begin = x_begin + offset.x, .x_end = x + offset.x});
+            }
+        }
+        return RunLengthMask{std::move(runs)};
+    }
+
+    auto RunLengthMask::GetRuns() const -> std::span<PixelRun const> {
+        return runs_;
+    }
+
+    auto RunLengthMask::GetBounds() const -> cv::Rect {
+        return bounds_;
+    }
+
+    auto RunLengthMask::IsSet(cv::Point const& point) const -> bool {
+        auto const row = this->GetRow(point.y);
+        // the last run starting at or before the point
+        auto const next = std::ranges::upper_bound(row, point.x, {}, &PixelRun::x_begin);
+        return next != row.begin() && std::prev(next)->x_end > point.x;
+    }
+
+    auto RunLengthMask::SplitComponents() const -> std::vector<RunLengthMask> {
+        std::vector<std::size_t> parents(runs_.size());
+        std::iota(parents.begin(), parents.end(), 0uz);
+
+        // runs of consecutive rows are 8-connected if they overlap when one of them is widened by a pixel on each side
+        for (auto y = bounds_.y; y + 1 < bounds_.br().y; ++y) {
+            auto const upper = this->GetRow(y);
+            auto const lower = this->GetRow(y + 1);
+            for (std::size_t i = 0, j = 0; i < upper.size() && j < lower.size();) {
+                if (upper[i].x_end < lower[j].x_begin) {
+                    ++i;
+                } else if (lower[j].x_end < upper[i].x_begin) {
+                    ++j;
+                } else {
+                    auto const a = FindRoot(parents, static_cast<std::size_t>(&upper[i] - runs_.data()));
+                    auto const b = FindRoot(parents, static_cast<std::size_t>(&lower[j] - runs_.data()));
+                    parents[std::max(a, b)] = std::min(a, b);
+                    // the run ending first can't touch any further run of the other row
+                    if (upper[i].x_end < lower[j].x_end) {
+                        ++i;
+                    } else {
+                        ++j;
+                    }
+                }
+            }
+        }
+
+        // the runs are sorted, thus the components are numbered in the order of their first pixel
+        std::vector<std::size_t> component_of_root(runs_.size(), runs_.size());
+        std::vector<std::vector<PixelRun>> component_runs;
+        for (std::size_t i = 0; i < runs_.size(); ++i) {
+            auto& component = component_of_root[FindRoot(parents, i)];
+            if (component == runs_.size()) {
+                component = component_runs.size();
+                component_runs.emplace_back();
+            }
+            component_runs[component].push_back(runs_[i]);
+        }
+
+        std::vector<RunLengthMask> components;
+        components.reserve(component_runs.size());
+        for (auto& runs : component_runs) {
+            components.emplace_back(std::move(runs));
+        }
+        return components;
+    }
+
+    auto RunLengthMask::TraceExternalContour() const -> std::vector<cv::Point> {
+        if (runs_.empty()) {
+            return {};
+        }
+
+        // the first pixel in raster order is where `cv::findContours` starts tracing the external border. the search
+        // for the next border pixel starts at the direction following the previous one (counter-clockwise), the
+        // contour gets a point whenever the direction changes (`cv::CHAIN_APPROX_SIMPLE`).
+        cv::Point const start{runs_.front().x_begin, runs_.front().y};
+        auto direction = 4;
+        do {
+            direction = (direction - 1) & 7;
+        } while (!this->IsSet(start + kNeighbourOffsets[direction]) && direction != 4);
+        if (direction == 4) {
+            return {start}; // single pixel
+        }
+
+        std::vector<cv::Point> contour;
+        auto const second = start + kNeighbourOffsets[direction];
+        auto previous_direction = direction ^ 4;
+        auto current = start;
+        while (true) {
+            // ends at the latest at the pixel which the border came from
+            cv::Point next;
+            do {
+                direction = (direction + 1) & 7;
+                next = current + kNeighbourOffsets[direction];
+            } while (!this->IsSet(next));
+
+            if (direction != previous_direction) {
+                contour.push_back(current);
+                previous_direction = direction;
+            }
+            if (next == start && current == second) {
+                return contour;
+            }
+            current = next;
+            direction = (direction + 4) & 7;
+        }
+    }
+
+    auto RunLengthMask::GetRow(int const y) const -> std::span<PixelRun const> {
+        if (y < bounds_.y || y >= bounds_.br().y) {
+            return {};
+        }
+        auto const row = static_cast<std::size_t>(y - bounds_.y);
+        return std::span{runs_}.subspan(row_starts_[row], row_starts_[row + 1] - row_starts_[row]);
+    }
+
+}
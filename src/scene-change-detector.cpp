@@ -0,0 +1,53 @@
+#include <utility>
+
+#include <banana-lib/scene-change-detector.hpp>
+
+namespace banana {
+
+    SceneChangeDetector::SceneChangeDetector(Settings settings) : settings_(std::move(settings)) {
+    }
+
+    auto SceneChangeDetector::NeedsAnalysis(cv::Mat const& frame) -> bool {
+        auto signature = this->CalculateSignature(frame);
+
+        auto const is_refresh_due = settings_.max_skipped_frames > 0 && skipped_in_a_row_ >= settings_.max_skipped_frames;
+        if (!is_refresh_due && !reference_signature_.empty() && reference_signature_.size() == signature.size()) {
+            cv::Mat difference;
+            cv::absdiff(signature, reference_signature_, difference);
+            auto const changed_cells = cv::countNonZero(difference > settings_.cell_difference_threshold);
+            if (changed_cells <= settings_.changed_cells_threshold * static_cast<double>(signature.total())) {
+                ++skipped_in_a_row_;
+                ++stats_.skipped_frames;
+                return false;
+            }
+        }
+
+        reference_signature_ = std::move(signature);
+        skipped_in_a_row_ = 0;
+        ++stats_.analyzed_frames;
+        return true;
+    }
+
+    void SceneChangeDetector::Reset() {
+        reference_signature_.release();
+    }
+
+    auto SceneChangeDetector::GetStats() const -> Stats {
+        return stats_;
+    }
+
+    auto SceneChangeDetector::CalculateSignature(cv::Mat const& frame) const -> cv::Mat {
+        // shrink first, then the color conversion only has to touch a few pixels
+        cv::Mat small;
+        cv::resize(frame, small, settings_.signature_size, 0, 0, cv::INTER_AREA);
+
+        cv::Mat signature;
+        if (small.channels() == 1) {
+            signature = small;
+        } else {
+            cv::cvtColor(small, signature, cv::COLOR_BGR2GRAY);
+        }
+        return signature;
+    }
+
+}
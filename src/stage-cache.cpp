@@ -0,0 +1,198 @@
+#include <bit>
+#include <chrono>
+#include <cstring>
+#include <format>
+#include <functional>
+#include <ranges>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <banana-lib/stage-cache.hpp>
+
+namespace banana {
+
+    auto StageHasher::Add(std::span<std::byte const> const data) -> StageHasher& {
+        auto const num_words = data.size() / sizeof(std::uint64_t);
+        for (std::size_t i = 0; i < num_words; ++i) {
+            std::uint64_t word;
+            std::memcpy(&word, data.data() + i * sizeof(word), sizeof(word));
+            this->Add(word);
+        }
+
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, data.data() + num_words * sizeof(tail), data.size() % sizeof(tail));
+        return this->Add(tail).Add(static_cast<std::uint64_t>(data.size()));
+    }
+
+    auto StageHasher::Add(std::uint64_t const value) -> StageHasher& {
+        hash_ = (hash_ ^ value) * 1099511628211ull;
+        // fold the upper bits back in, otherwise differences in them would never reach the lower bits
+        hash_ ^= hash_ >> 32;
+        return *this;
+    }
+
+    auto StageHasher::Add(double const value) -> StageHasher& {
+        return this->Add(std::bit_cast<std::uint64_t>(value));
+    }
+
+    auto StageHasher::Add(cv::Scalar const& value) -> StageHasher& {
+        return this->Add(value[0]).Add(value[1]).Add(value[2]).Add(value[3]);
+    }
+
+    auto StageHasher::Add(Contour const& contour) -> StageHasher& {
+        this->Add(static_cast<std::uint64_t>(contour.size()));
+        for (auto const& point : contour) {
+            this->Add((static_cast<std::uint64_t>(static_cast<std::uint32_t>(point.x)) << 32) | static_cast<std::uint32_t>(point.y));
+        }
+        return *this;
+    }
+
+    auto StageHasher::Get() const -> std::uint64_t {
+        return hash_;
+    }
+
+    StageCache::StageCache(std::filesystem::path directory) : directory_(std::move(directory)) {
+        std::filesystem::create_directories(directory_);
+    }
+
+    auto StageCache::HashImage(cv::Mat const& image) -> std::uint64_t {
+        StageHasher hasher;
+        hasher.Add(static_cast<std::uint64_t>(image.rows))
+              .Add(static_cast<std::uint64_t>(image.cols))
+              .Add(static_cast<std::uint64_t>(image.type()));
+
+        auto const row_size = static_cast<std::size_t>(image.cols) * image.elemSize();
+        for (auto y = 0; y < image.rows; ++y) {
+            hasher.Add(std::span{reinterpret_cast<std::byte const*>(image.ptr(y)), row_size});
+        }
+        return hasher.Get();
+    }
+
+    auto StageCache::GetEntryPath(std::uint64_t const image_hash, std::uint64_t const settings_hash, std::string const& stage) const -> std::filesystem::path {
+        return directory_ / std::format("{:016x}-{:016x}.{}.yml", image_hash, settings_hash, stage);
+    }
+
+    namespace {
+        /**
+         * Write an entry to a temporary file first and only move it to its final place once it's complete, so that
+         * other processes never see partially written entries.
+         */
+        void WriteEntry(std::filesystem::path const& path, std::function<void(cv::FileStorage&)> const& write) {
+            auto const unique_id = std::hash<std::thread::id>{}(std::this_thread::get_id())
+                                   ^ static_cast<std::size_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+            auto temp_path = path;
+            temp_path.replace_extension(std::format("{:x}.tmp.yml", unique_id));
+
+            try {
+                cv::FileStorage fs(temp_path.string(), cv::FileStorage::WRITE);
+                if (!fs.isOpened()) {
+                    return;
+                }
+                write(fs);
+                fs.release();
+
+                std::error_code error;
+                std::filesystem::rename(temp_path, path, error);
+                if (error) {
+                    std::filesystem::remove(temp_path, error);
+                }
+            } catch (cv::Exception const&) {
+                std::error_code error;
+                std::filesystem::remove(temp_path, error);
+            }
+        }
+
+        /**
+         * Read an entry if it exists.
+         *
+         * @return whether the entry could be read. `read` may also return `false` to indicate a broken entry.
+         */
+        [[nodiscard]]
+        auto ReadEntry(std::filesystem::path const& path, std::function<bool(cv::FileStorage const&)> const& read) -> bool {
+            if (!std::filesystem::exists(path)) {
+                return false;
+            }
+
+            try {
+                cv::FileStorage const fs(path.string(), cv::FileStorage::READ);
+                return fs.isOpened() && read(fs);
+            } catch (cv::Exception const&) {
+                return false;
+            }
+        }
+    }
+
+    auto StageCache::LoadShapes(std::uint64_t const image_hash, std::uint64_t const settings_hash) const -> std::optional<std::vector<BananaShape>> {
+        std::vector<BananaShape> shapes;
+        auto const is_valid = ReadEntry(this->GetEntryPath(image_hash, settings_hash, "shapes"), [&shapes](cv::FileStorage const& fs) {
+            for (auto const& node : fs["bananas"]) {
+                BananaShape shape;
+                std::vector<double> coefficients;
+                node["contour"] >> shape.contour;
+                node["rotation_angle"] >> shape.rotation_angle;
+                node["estimated_center"] >> shape.estimated_center;
+                node["center_line_coefficients"] >> coefficients;
+                if (shape.contour.empty() || coefficients.size() != 3) {
+                    return false;
+                }
+                shape.center_line_coefficients = {coefficients[0], coefficients[1], coefficients[2]};
+                if (!node["zone_id"].empty()) {
+                    int zone_id;
+                    node["zone_id"] >> zone_id;
+                    shape.zone_id = zone_id;
+                }
+                shapes.push_back(std::move(shape));
+            }
+            return true;
+        });
+
+        return is_valid ? std::optional{std::move(shapes)} : std::nullopt;
+    }
+
+    void StageCache::StoreShapes(std::uint64_t const image_hash, std::uint64_t const settings_hash, std::vector<BananaShape> const& shapes) const {
+        WriteEntry(this->GetEntryPath(image_hash, settings_hash, "shapes"), [&shapes](cv::FileStorage& fs) {
+            fs << "bananas" << "[";
+            for (auto const& shape : shapes) {
+                auto const& [coeff_0, coeff_1, coeff_2] = shape.center_line_coefficients;
+                fs << "{"
+                   << "contour" << shape.contour
+                   << "rotation_angle" << shape.rotation_angle
+                   << "estimated_center" << shape.estimated_center
+                   << "center_line_coefficients" << std::vector{coeff_0, coeff_1, coeff_2};
+                if (shape.zone_id) {
+                    fs << "zone_id" << *shape.zone_id;
+                }
+                fs << "}";
+            }
+            fs << "]";
+        });
+    }
+
+    auto StageCache::LoadRipeness(std::uint64_t const image_hash, std::uint64_t const settings_hash) const -> std::optional<std::vector<RipenessEstimate>> {
+        std::vector<RipenessEstimate> ripeness;
+        auto const is_valid = ReadEntry(this->GetEntryPath(image_hash, settings_hash, "ripeness"), [&ripeness](cv::FileStorage const& fs) {
+            std::vector<float> values, uncertainties;
+            fs["ripeness"] >> values;
+            fs["uncertainty"] >> uncertainties;
+            if (values.size() != uncertainties.size()) {
+                return false;
+            }
+            ripeness = std::views::zip_transform([](float const value, float const uncertainty) -> RipenessEstimate {
+                           return {value, uncertainty};
+                       }, values, uncertainties)
+                       | std::ranges::to<std::vector>();
+            return true;
+        });
+
+        return is_valid ? std::optional{std::move(ripeness)} : std::nullopt;
+    }
+
+    void StageCache::StoreRipeness(std::uint64_t const image_hash, std::uint64_t const settings_hash, std::vector<RipenessEstimate> const& ripeness) const {
+        WriteEntry(this->GetEntryPath(image_hash, settings_hash, "ripeness"), [&ripeness](cv::FileStorage& fs) {
+            fs << "ripeness" << (ripeness | std::views::transform(&RipenessEstimate::ripeness) | std::ranges::to<std::vector>());
+            fs << "uncertainty" << (ripeness | std::views::transform(&RipenessEstimate::uncertainty) | std::ranges::to<std::vector>());
+        });
+    }
+
+}
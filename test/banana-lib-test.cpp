@@ -1,9 +1,32 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <filesystem>
+#include <iterator>
+#include <limits>
+#include <list>
+#include <numeric>
+#include <optional>
+#include <ranges>
+#include <span>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
 
 #include <gtest/gtest.h>
 
+#include <banana-lib/banana.h>
+#include <banana-lib/binary-mask.hpp>
 #include <banana-lib/lib.hpp>
+#include <banana-lib/metrics-aggregator.hpp>
+#include <banana-lib/result-bus.hpp>
+#include <banana-lib/run-length-mask.hpp>
+#include <banana-lib/scene-change-detector.hpp>
+#include <banana-lib/stage-cache.hpp>
+#include <banana-lib/static-analyzer.hpp>
 
 #include "polyfit-test-util.hpp"
 
@@ -64,3 +87,650 @@ TEST(PCATestSuite, SingleBanana00) {
     GET_RESULT("resources/test-images/banana-00.jpg", 1);
     ASSERT_NEAR(-0.0484120, result.banana.front().rotation_angle, 1e-6);
 }
+
+TEST(BandedDetectionTestSuite, SameResultAsWholeImage) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+
+    // the bananas may be found in a different order
+    auto const by_start_point = [](auto const& a, auto const& b) {
+        return std::pair{a.contour.front().y, a.contour.front().x} < std::pair{b.contour.front().y, b.contour.front().x};
+    };
+    auto expected_bananas = *result | std::ranges::to<std::vector>();
+    std::ranges::sort(expected_bananas, by_start_point);
+
+    // the bananas cross several band borders, with the narrow bands each of them spans many bands
+    for (auto const band_height : {97, 16}) {
+        banana::Analyzer const banded_analyzer{{
+            .pixels_per_meter = 1,
+            .detection_band_height = band_height,
+        }};
+        auto const banded_result = banded_analyzer.AnalyzeImage(image);
+        ASSERT_TRUE(banded_result);
+        ASSERT_EQ(2, banded_result->size());
+
+        auto banded_bananas = *banded_result | std::ranges::to<std::vector>();
+        std::ranges::sort(banded_bananas, by_start_point);
+        for (auto const& [expected, banded] : std::views::zip(expected_bananas, banded_bananas)) {
+            ASSERT_EQ(expected.contour, banded.contour);
+            ASSERT_EQ(expected.ripeness, banded.ripeness);
+        }
+    }
+}
+
+TEST(SceneChangeDetectorTestSuite, SkipUnchangedFrames) {
+    banana::SceneChangeDetector detector{{
+        .max_skipped_frames = 2,
+    }};
+    auto const empty = cv::imread("resources/test-images/empty.jpg");
+    auto const banana = cv::imread("resources/test-images/banana-00.jpg");
+
+    ASSERT_TRUE(detector.NeedsAnalysis(empty));
+    ASSERT_FALSE(detector.NeedsAnalysis(empty));
+    ASSERT_FALSE(detector.NeedsAnalysis(empty));
+    ASSERT_TRUE(detector.NeedsAnalysis(empty)); // forced refresh
+    ASSERT_TRUE(detector.NeedsAnalysis(banana));
+    ASSERT_FALSE(detector.NeedsAnalysis(banana));
+
+    auto const stats = detector.GetStats();
+    ASSERT_EQ(3, stats.analyzed_frames);
+    ASSERT_EQ(3, stats.skipped_frames);
+}
+
+TEST(StaticAnalyzerTestSuite, SameResultAsAnalyzer) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    banana::StaticAnalyzer<banana::StaticSettings{.pixels_per_meter = 1}> const static_analyzer;
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    auto const static_result = static_analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(static_result);
+    ASSERT_EQ(2, static_result->size());
+
+    for (auto const& [expected, actual] : std::views::zip(*result, *static_result)) {
+        ASSERT_EQ(expected.contour, actual.contour);
+        ASSERT_EQ(expected.ripeness, actual.ripeness);
+        ASSERT_COEFFS_NEAR(std::get<0>(expected.center_line.coefficients), std::get<1>(expected.center_line.coefficients),
+                           std::get<2>(expected.center_line.coefficients), actual.center_line.coefficients);
+    }
+}
+
+TEST(StageCacheTestSuite, SameResultWithCache) {
+    auto const cache_directory = std::filesystem::temp_directory_path() / "banana-stage-cache-test";
+    std::filesystem::remove_all(cache_directory);
+    banana::StageCache const cache{cache_directory};
+
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const expected_result = analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(expected_result);
+
+    // the first run fills the cache, the second one uses it
+    for (auto i = 0; i < 2; ++i) {
+        auto const result = analyzer.AnalyzeImage(image, cache);
+        ASSERT_TRUE(result);
+        ASSERT_EQ(expected_result->size(), result->size());
+        for (auto const& [expected, actual] : std::views::zip(*expected_result, *result)) {
+            ASSERT_EQ(expected.contour, actual.contour);
+            ASSERT_EQ(expected.rotation_angle, actual.rotation_angle);
+            ASSERT_EQ(expected.center_line.coefficients, actual.center_line.coefficients);
+            ASSERT_EQ(expected.length, actual.length);
+            ASSERT_EQ(expected.ripeness, actual.ripeness);
+        }
+    }
+    ASSERT_EQ(2, std::ranges::distance(std::filesystem::directory_iterator{cache_directory}));
+
+    // only the calibration changed => the cached shapes and ripeness are used
+    banana::Analyzer const recalibrated_analyzer{{
+        .pixels_per_meter = 2,
+    }};
+    auto const recalibrated_result = recalibrated_analyzer.AnalyzeImage(image, cache);
+    ASSERT_TRUE(recalibrated_result);
+    ASSERT_EQ(2, std::ranges::distance(std::filesystem::directory_iterator{cache_directory}));
+    ASSERT_DOUBLE_EQ(expected_result->front().length / 2, recalibrated_result->front().length);
+
+    std::filesystem::remove_all(cache_directory);
+}
+
+TEST(SampledRipenessTestSuite, WithinUncertaintyOfExactRipeness) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    banana::Analyzer const sampling_analyzer{{
+        .pixels_per_meter = 1,
+        .ripeness_sample_budget = 2000,
+        .ripeness_max_uncertainty = 1, // always accept the sampled estimate
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    auto const sampled_result = sampling_analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(sampled_result);
+    ASSERT_EQ(result->size(), sampled_result->size());
+
+    for (auto const& [expected, sampled] : std::views::zip(*result, *sampled_result)) {
+        ASSERT_EQ(0, expected.ripeness_uncertainty);
+        ASSERT_GT(sampled.ripeness_uncertainty, 0);
+        // allow twice the 95% interval so that the (deterministic) test isn't on the edge
+        ASSERT_NEAR(expected.ripeness, sampled.ripeness, 2 * sampled.ripeness_uncertainty);
+    }
+}
+
+TEST(SampledRipenessTestSuite, FallBackToExactRipeness) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    banana::Analyzer const sampling_analyzer{{
+        .pixels_per_meter = 1,
+        .ripeness_sample_budget = 10,
+        .ripeness_max_uncertainty = -1, // never accept a sampled estimate
+    }};
+    auto const image = cv::imread("resources/test-images/banana-00.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    auto const sampled_result = sampling_analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(sampled_result);
+    ASSERT_EQ(1, sampled_result->size());
+    ASSERT_EQ(result->front().ripeness, sampled_result->front().ripeness);
+    ASSERT_EQ(0, sampled_result->front().ripeness_uncertainty);
+}
+
+TEST(CandidateContoursTestSuite, SameContoursAsWholeMask) {
+    banana::Analyzer const analyzer{{
+        .min_area = 500,
+        .pixels_per_meter = 1,
+    }};
+
+    cv::Mat mask{300, 400, CV_8UC1, cv::Scalar{0}};
+    cv::circle(mask, {100, 100}, 80, cv::Scalar{255}, 20); // ring
+    cv::rectangle(mask, {80, 80}, {120, 120}, cv::Scalar{255}, cv::FILLED); // inside the hole of the ring
+    cv::ellipse(mask, {300, 200}, {60, 30}, 30, 0, 360, cv::Scalar{255}, cv::FILLED);
+    cv::rectangle(mask, {250, 20}, {270, 30}, cv::Scalar{255}, cv::FILLED); // too small
+    cv::line(mask, {200, 280}, {390, 280}, cv::Scalar{255}); // thin, i.e. no area
+    cv::rectangle(mask, {0, 250}, {60, 299}, cv::Scalar{255}, cv::FILLED); // touching the image border
+
+    banana::Contours expected;
+    cv::findContours(mask, expected, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+    std::erase_if(expected, [](auto const& contour) { return cv::contourArea(contour) <= 500; });
+    auto actual = analyzer.FindCandidateContours(mask);
+
+    auto const by_start_point = [](auto const& a, auto const& b) {
+        return std::pair{a.front().y, a.front().x} < std::pair{b.front().y, b.front().x};
+    };
+    std::ranges::sort(expected, by_start_point);
+    std::ranges::sort(actual, by_start_point);
+    ASSERT_EQ(3, expected.size());
+    ASSERT_EQ(expected, actual);
+}
+
+TEST(CandidateContoursTestSuite, EmptyMask) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    cv::Mat const mask{300, 400, CV_8UC1, cv::Scalar{0}};
+    ASSERT_TRUE(analyzer.FindCandidateContours(mask).empty());
+}
+
+/// Random noise with some larger blobs, similar to a colour filtered image.
+[[nodiscard]]
+auto CreateTestMask(cv::Size const size) -> cv::Mat {
+    cv::Mat noise{size, CV_8UC1};
+    cv::randu(noise, 0, 256);
+    cv::Mat mask = noise > 230;
+    cv::RNG rng{42};
+    for (auto i = 0; i < 10; ++i) {
+        cv::ellipse(mask, {rng.uniform(0, size.width), rng.uniform(0, size.height)},
+                    {rng.uniform(5, size.width / 3), rng.uniform(5, size.height / 3)}, rng.uniform(0, 180), 0, 360,
+                    cv::Scalar{255}, cv::FILLED);
+    }
+    return mask;
+}
+
+/// Results of a banana without contour and center line, for the components which only use the measured values.
+[[nodiscard]]
+auto CreateTestBanana(float const ripeness, double const mean_curvature = 20, double const length = 0.2) -> banana::AnalysisResult {
+    return {.contour = {}, .center_line = {}, .rotation_angle = 0, .estimated_center = {}, .mean_curvature = mean_curvature, .length = length, .ripeness = ripeness};
+}
+
+/// The external contour of each 8-connected component of the mask, as found by `cv::findContours`, ordered by their first point.
+[[nodiscard]]
+auto GetComponentContours(cv::Mat const& mask) -> banana::Contours {
+    cv::Mat labels;
+    auto const num_labels = cv::connectedComponents(mask, labels, 8);
+    banana::Contours contours;
+    for (auto label = 1; label < num_labels; ++label) {
+        banana::Contours component_contours;
+        cv::Mat const component_mask = labels == label;
+        cv::findContours(component_mask, component_contours, cv::RETR_EXTERNAL, cv::CHAIN_APPROX_SIMPLE);
+        contours.push_back(std::move(component_contours.front()));
+    }
+    std::ranges::sort(contours, {}, [](auto const& contour) { return std::pair{contour.front().y, contour.front().x}; });
+    return contours;
+}
+
+TEST(RunLengthMaskTestSuite, SameContoursAsOpenCV) {
+    auto const mask = CreateTestMask({201, 67});
+    auto const run_length_mask = banana::RunLengthMask::FromMat(mask, {10, 20});
+    ASSERT_EQ(run_length_mask.GetBounds(), run_length_mask.GetBounds() & cv::Rect{10, 20, 201, 67});
+    for (auto y = 0; y < mask.rows; ++y) {
+        for (auto x = 0; x < mask.cols; ++x) {
+            ASSERT_EQ(mask.at<std::uint8_t>(y, x) != 0, run_length_mask.IsSet({x + 10, y + 20}));
+        }
+    }
+
+    auto const expected = GetComponentContours(mask);
+    auto const components = run_length_mask.SplitComponents();
+    ASSERT_EQ(expected.size(), components.size());
+    for (auto const& [expected_contour, component] : std::views::zip(expected, components)) {
+        auto contour = component.TraceExternalContour();
+        for (auto& point : contour) {
+            point -= cv::Point{10, 20};
+        }
+        ASSERT_EQ(expected_contour, contour);
+    }
+}
+
+TEST(RunLengthMaskTestSuite, StitchBands) {
+    // a chain of touching objects running zig-zag through all bands and a ring spanning several bands with an object in its hole
+    cv::Mat mask{300, 300, CV_8UC1, cv::Scalar{0}};
+    cv::polylines(mask, std::vector{std::vector<cv::Point>{{10, 0}, {140, 60}, {10, 120}, {140, 180}, {10, 240}, {140, 299}}}, false, cv::Scalar{255}, 9);
+    cv::circle(mask, {230, 150}, 50, cv::Scalar{255}, 5);
+    cv::circle(mask, {230, 150}, 10, cv::Scalar{255}, cv::FILLED);
+
+    constexpr auto kBandHeight = 50;
+    std::vector<banana::PixelRun> runs;
+    for (auto y = 0; y < mask.rows; y += kBandHeight) {
+        auto const band = banana::RunLengthMask::FromMat(mask(cv::Rect{0, y, mask.cols, kBandHeight}), {0, y});
+        ASSERT_LE(band.GetBounds().height, kBandHeight);
+        std::ranges::copy(band.GetRuns(), std::back_inserter(runs));
+    }
+    banana::RunLengthMask const stitched_mask{std::move(runs)};
+
+    auto const expected = GetComponentContours(mask);
+    auto const components = stitched_mask.SplitComponents();
+    ASSERT_EQ(3, expected.size());
+    ASSERT_EQ(expected.size(), components.size());
+    for (auto const& [expected_contour, component] : std::views::zip(expected, components)) {
+        ASSERT_EQ(expected_contour, component.TraceExternalContour());
+    }
+
+    // the objects span the whole mask, but the stitched mask needs less memory than the mask of a single band
+    ASSERT_EQ(mask.rows, components.front().GetBounds().height);
+    ASSERT_LT(stitched_mask.GetRuns().size() * sizeof(banana::PixelRun), static_cast<std::size_t>(kBandHeight * mask.cols));
+}
+
+TEST(BinaryMaskTestSuite, RoundTrip) {
+    auto const mask = CreateTestMask({201, 67});
+    ASSERT_SAME_MAT(mask, banana::BinaryMask::FromMat(mask).ToMat());
+}
+
+TEST(BinaryMaskTestSuite, SameMorphologyAsOpenCV) {
+    // the widths cover partially and completely used words
+    for (auto const& size : {cv::Size{201, 67}, cv::Size{128, 50}}) {
+        auto const mask = CreateTestMask(size);
+        auto const binary_mask = banana::BinaryMask::FromMat(mask);
+        for (auto const kernel_size : {1, 3, 4, 5, 9}) {
+            auto const kernel = cv::getStructuringElement(cv::MORPH_RECT, {kernel_size, kernel_size});
+            cv::Mat expected;
+
+            cv::erode(mask, expected, kernel);
+            ASSERT_SAME_MAT(expected, binary_mask.Erode(kernel_size).ToMat());
+
+            cv::dilate(mask, expected, kernel);
+            ASSERT_SAME_MAT(expected, binary_mask.Dilate(kernel_size).ToMat());
+
+            cv::morphologyEx(mask, expected, cv::MORPH_OPEN, kernel);
+            ASSERT_SAME_MAT(expected, binary_mask.Open(kernel_size).ToMat());
+        }
+    }
+}
+
+TEST(BinaryMaskTestSuite, MajorityFilterSameAsMedianBlur) {
+    for (auto const& size : {cv::Size{201, 67}, cv::Size{128, 50}, cv::Size{640, 480}}) {
+        auto const mask = CreateTestMask(size);
+        auto const binary_mask = banana::BinaryMask::FromMat(mask);
+        for (auto const kernel_size : {3, 5, 37}) {
+            cv::Mat expected;
+            cv::medianBlur(mask, expected, kernel_size);
+            ASSERT_SAME_MAT(expected, binary_mask.MajorityFilter(kernel_size).ToMat());
+        }
+    }
+}
+
+TEST(BinaryMaskTestSuite, SameResultAsOpenCVPath) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    banana::Analyzer const bit_packed_analyzer{{
+        .pixels_per_meter = 1,
+        .bit_packed_detection_mask = true,
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    auto const bit_packed_result = bit_packed_analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+    ASSERT_TRUE(bit_packed_result);
+    ASSERT_EQ(result->size(), bit_packed_result->size());
+    for (auto const& [expected, actual] : std::views::zip(*result, *bit_packed_result)) {
+        ASSERT_EQ(expected.contour, actual.contour);
+        ASSERT_EQ(expected.ripeness, actual.ripeness);
+    }
+}
+
+TEST(CApiTestSuite, SameResultAsAnalyzer) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const expected_result = analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(expected_result);
+
+    banana_settings_t settings;
+    banana_settings_init(&settings);
+    settings.pixels_per_meter = 1;
+    banana_analyzer_t* c_analyzer = nullptr;
+    ASSERT_EQ(BANANA_STATUS_OK, banana_analyzer_create(&settings, &c_analyzer));
+
+    // RGBA with padding at the end of the rows
+    cv::Mat rgba_buffer{image.rows, image.cols + 3, CV_8UC4};
+    cv::Mat rgba_image = rgba_buffer.colRange(0, image.cols);
+    cv::cvtColor(image, rgba_image, cv::COLOR_BGR2RGBA);
+
+    for (auto const& [data, stride, format] : {std::tuple{image.data, image.step[0], BANANA_PIXEL_FORMAT_BGR8},
+                                              std::tuple{rgba_image.data, rgba_image.step[0], BANANA_PIXEL_FORMAT_RGBA8}}) {
+        banana_image_t const c_image{data, image.cols, image.rows, stride, format};
+        std::vector<banana_result_t> results(1);
+        std::vector<banana_point_t> contour_points(10000);
+        banana_output_t output{results.data(), results.size(), 0, contour_points.data(), contour_points.size(), 0};
+
+        // too small for all results, but tells how many there are
+        ASSERT_EQ(BANANA_STATUS_BUFFER_TOO_SMALL, banana_analyze(c_analyzer, &c_image, &output));
+        ASSERT_EQ(expected_result->size(), output.num_results);
+
+        results.resize(output.num_results);
+        output.results = results.data();
+        output.results_capacity = results.size();
+        ASSERT_EQ(BANANA_STATUS_OK, banana_analyze(c_analyzer, &c_image, &output));
+
+        for (auto const& [expected, actual] : std::views::zip(*expected_result, results)) {
+            auto const contour = std::span{contour_points}.subspan(actual.contour_offset, actual.contour_size)
+                                 | std::views::transform([](auto const& p) { return cv::Point{p.x, p.y}; })
+                                 | std::ranges::to<banana::Contour>();
+            ASSERT_EQ(expected.contour, contour);
+            ASSERT_EQ(expected.ripeness, actual.ripeness);
+            ASSERT_EQ(expected.length, actual.length);
+            ASSERT_EQ(std::get<2>(expected.center_line.coefficients), actual.center_line_coefficients[2]);
+        }
+    }
+
+    banana_analyzer_destroy(c_analyzer);
+}
+
+TEST(CApiTestSuite, RejectInvalidArguments) {
+    banana_settings_t settings;
+    banana_settings_init(&settings);
+    banana_analyzer_t* analyzer = nullptr;
+    ASSERT_EQ(BANANA_STATUS_INVALID_ARGUMENT, banana_analyzer_create(&settings, &analyzer)); // pixels_per_meter isn't set
+    ASSERT_NE(std::string{}, banana_get_last_error_message());
+
+    settings.pixels_per_meter = 1;
+    ASSERT_EQ(BANANA_STATUS_OK, banana_analyzer_create(&settings, &analyzer));
+
+    std::vector<std::uint8_t> pixels(10 * 10 * 3);
+    banana_image_t const image{pixels.data(), 10, 10, 10, BANANA_PIXEL_FORMAT_BGR8}; // stride too small
+    banana_output_t output{};
+    ASSERT_EQ(BANANA_STATUS_INVALID_ARGUMENT, banana_analyze(analyzer, &image, &output));
+
+    banana_analyzer_destroy(analyzer);
+}
+
+TEST(CApiTestSuite, InspectionZones) {
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    banana_image_t const c_image{image.data, image.cols, image.rows, image.step[0], BANANA_PIXEL_FORMAT_BGR8};
+    std::vector<banana_result_t> results(10);
+
+    banana_settings_t settings;
+    banana_settings_init(&settings);
+    settings.pixels_per_meter = 1;
+    auto const analyze = [&](banana_settings_t const& zone_settings) {
+        banana_analyzer_t* analyzer = nullptr;
+        EXPECT_EQ(BANANA_STATUS_OK, banana_analyzer_create(&zone_settings, &analyzer));
+        banana_output_t output{results.data(), results.size(), 0, nullptr, 0, 0};
+        EXPECT_EQ(BANANA_STATUS_OK, banana_analyze(analyzer, &c_image, &output));
+        banana_analyzer_destroy(analyzer);
+        return std::span{results}.first(output.num_results);
+    };
+
+    auto const without_zones = analyze(settings);
+    ASSERT_EQ(2, without_zones.size());
+    ASSERT_TRUE(std::ranges::all_of(without_zones, [](auto const& result) { return result.zone_id == -1; }));
+
+    // the zone is copied, thus the points only need to live until the analyzer has been created
+    std::vector<banana_point_t> const whole_image{{0, 0}, {image.cols - 1, 0}, {image.cols - 1, image.rows - 1}, {0, image.rows - 1}};
+    banana_inspection_zone_t const zone{7, whole_image.data(), whole_image.size()};
+    settings.inspection_zones = &zone;
+    settings.num_inspection_zones = 1;
+    auto const with_zone = analyze(settings);
+    ASSERT_EQ(2, with_zone.size());
+    ASSERT_TRUE(std::ranges::all_of(with_zone, [](auto const& result) { return result.zone_id == 7; }));
+
+    banana_inspection_zone_t const line{8, whole_image.data(), 2};
+    settings.inspection_zones = &line;
+    banana_analyzer_t* analyzer = nullptr;
+    ASSERT_EQ(BANANA_STATUS_INVALID_ARGUMENT, banana_analyzer_create(&settings, &analyzer));
+}
+
+TEST(InspectionZoneTestSuite, FindEachBananaInItsZone) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(2, result->size());
+    ASSERT_FALSE(result->front().zone_id);
+
+    // a zone around each banana, far enough from it that the crop doesn't change its contour
+    std::vector<banana::InspectionZone> zones;
+    for (auto const& [n, banana] : std::ranges::enumerate_view(*result)) {
+        auto const bounds = cv::boundingRect(banana.contour);
+        auto const zone = cv::Rect{bounds.x - 50, bounds.y - 50, bounds.width + 100, bounds.height + 100} & cv::Rect{{0, 0}, image.size()};
+        zones.push_back({
+            .id = 10 + static_cast<int>(n),
+            .polygon = {zone.tl(), {zone.br().x - 1, zone.y}, zone.br() - cv::Point{1, 1}, {zone.x, zone.br().y - 1}},
+        });
+    }
+    banana::Analyzer const zone_analyzer{{
+        .pixels_per_meter = 1,
+        .inspection_zones = zones,
+    }};
+    auto const zone_result = zone_analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(zone_result);
+
+    for (auto const& [n, expected] : std::ranges::enumerate_view(*result)) {
+        auto const found = std::ranges::find_if(*zone_result, [&expected](auto const& banana) { return banana.contour == expected.contour; });
+        ASSERT_NE(zone_result->end(), found);
+        ASSERT_EQ(10 + static_cast<int>(n), found->zone_id);
+        ASSERT_EQ(expected.ripeness, found->ripeness);
+    }
+}
+
+TEST(InspectionZoneTestSuite, IgnoreBananasOutsideOfZones) {
+    banana::Analyzer const analyzer{{
+        .pixels_per_meter = 1,
+        .inspection_zones = {{.id = 1, .polygon = {{0, 0}, {20, 0}, {0, 20}}}},
+    }};
+    auto const image = cv::imread("resources/test-images/banana-22.jpg");
+    auto const result = analyzer.AnalyzeImage(image);
+    ASSERT_TRUE(result);
+    ASSERT_EQ(0, result->size());
+}
+
+TEST(MetricsAggregatorTestSuite, AggregateWithinWindow) {
+    banana::MetricsAggregator aggregator{{
+        .bucket_duration = std::chrono::seconds{1},
+        .num_buckets = 10,
+    }};
+    banana::MetricsAggregator::Clock::time_point const start{std::chrono::hours{1}};
+
+    // 4 threads adding 100 frames each, with ripeness values spread evenly over [0, 2)
+    std::vector<std::jthread> threads;
+    for (auto t = 0; t < 4; ++t) {
+        threads.emplace_back([&, t] {
+            for (auto i = 0; i < 100; ++i) {
+                aggregator.AddFrame({CreateTestBanana(static_cast<float>(t * 100 + i) / 200)}, start + std::chrono::milliseconds{i * 10});
+            }
+        });
+    }
+    threads.clear();
+    aggregator.AddFrame({}, start);
+
+    auto const snapshot = aggregator.Snapshot(start + std::chrono::seconds{1});
+    ASSERT_EQ(401, snapshot.frames);
+    ASSERT_EQ(400, snapshot.ripeness.count);
+    ASSERT_NEAR(0.9975, snapshot.ripeness.mean, 1e-4);
+    ASSERT_NEAR(400.0 * 400.0 / 12 / 200 / 200, snapshot.ripeness.variance, 1e-2);
+    ASSERT_NEAR(1.0, snapshot.ripeness.Quantile(0.5), 2.0 / banana::MetricsAggregator::kHistogramBins);
+    ASSERT_NEAR(1.8, snapshot.ripeness.Quantile(0.9), 2.0 / banana::MetricsAggregator::kHistogramBins);
+    ASSERT_NEAR(0.2, snapshot.length.mean, 1e-9);
+    ASSERT_NEAR(0, snapshot.length.variance, 1e-9);
+    ASSERT_NEAR(20, snapshot.mean_curvature.Quantile(0.5), 50.0 / banana::MetricsAggregator::kHistogramBins);
+
+    // once the window moved past them the results are dropped, as are results which are too old
+    aggregator.AddFrame({CreateTestBanana(1)}, start + std::chrono::seconds{20});
+    aggregator.AddFrame({CreateTestBanana(1)}, start + std::chrono::seconds{5});
+    auto const later_snapshot = aggregator.Snapshot(start + std::chrono::seconds{20});
+    ASSERT_EQ(1, later_snapshot.frames);
+    ASSERT_EQ(1, later_snapshot.ripeness.count);
+    ASSERT_TRUE(std::isnan(later_snapshot.ripeness.variance));
+}
+
+TEST(MetricsAggregatorTestSuite, ReuseBucketsWhileAdding) {
+    banana::MetricsAggregator aggregator{{
+        .bucket_duration = std::chrono::milliseconds{1},
+        .num_buckets = 2,
+    }};
+    banana::MetricsAggregator::Clock::time_point const start{std::chrono::hours{1}};
+
+    // the threads run through the periods at different speeds, thus the buckets are reused while others still add to them
+    constexpr auto kNumPeriods = 200;
+    constexpr auto kFramesPerPeriod = 20;
+    std::vector<std::jthread> threads;
+    for (auto t = 0; t < 4; ++t) {
+        threads.emplace_back([&] {
+            for (auto period = 0; period < kNumPeriods; ++period) {
+                for (auto i = 0; i < kFramesPerPeriod; ++i) {
+                    aggregator.AddFrame({CreateTestBanana(0.5), CreateTestBanana(1.5)}, start + std::chrono::milliseconds{period});
+                }
+            }
+        });
+    }
+    threads.clear();
+
+    // the buckets of the last two periods are never reused, thus none of their results may be lost or be left over from older ones
+    auto const snapshot = aggregator.Snapshot(start + std::chrono::milliseconds{kNumPeriods - 1});
+    ASSERT_EQ(4 * 2 * kFramesPerPeriod, snapshot.frames);
+    ASSERT_EQ(2 * snapshot.frames, snapshot.ripeness.count);
+    ASSERT_EQ(snapshot.ripeness.count, std::accumulate(snapshot.ripeness.histogram.cbegin(), snapshot.ripeness.histogram.cend(), std::uint64_t{0}));
+    ASSERT_NEAR(1.0, snapshot.ripeness.mean, 1e-9);
+    ASSERT_NEAR(0.2, snapshot.length.mean, 1e-9);
+}
+
+TEST(MetricsAggregatorTestSuite, IgnoreNonFiniteValues) {
+    banana::MetricsAggregator aggregator{{
+        .bucket_duration = std::chrono::seconds{1},
+        .num_buckets = 10,
+    }};
+    banana::MetricsAggregator::Clock::time_point const start{std::chrono::hours{1}};
+
+    aggregator.AddFrame({CreateTestBanana(1, 20), CreateTestBanana(1, std::numeric_limits<double>::quiet_NaN()), CreateTestBanana(1, std::numeric_limits<double>::infinity()), CreateTestBanana(1, 30)}, start);
+
+    auto const snapshot = aggregator.Snapshot(start);
+    ASSERT_EQ(2, snapshot.mean_curvature.count);
+    ASSERT_EQ(2, snapshot.mean_curvature.non_finite_count);
+    ASSERT_NEAR(25, snapshot.mean_curvature.mean, 1e-9);
+    ASSERT_EQ(2, std::accumulate(snapshot.mean_curvature.histogram.cbegin(), snapshot.mean_curvature.histogram.cend(), std::uint64_t{0}));
+    ASSERT_EQ(4, snapshot.length.count);
+    ASSERT_EQ(0, snapshot.length.non_finite_count);
+}
+
+TEST(ResultBusTestSuite, ReadConsistentFramesWhilePublishing) {
+    banana::ResultBus bus{8};
+    banana::ResultBus::Clock::time_point const start{std::chrono::hours{1}};
+    ASSERT_FALSE(bus.ReadLatest().has_value());
+    banana::ResultBus::Subscriber late_subscriber{bus};
+
+    auto const make_frame = [](std::uint64_t const sequence) -> std::list<banana::AnalysisResult> {
+        std::list<banana::AnalysisResult> results;
+        for (std::uint64_t i = 0; i <= sequence % 3; ++i) {
+            results.push_back(CreateTestBanana(1, 20, static_cast<double>(sequence)));
+        }
+        return results;
+    };
+    // every frame read must have been completely written by the writer, whichever frame the readers get
+    auto const expect_consistent = [](banana::PublishedFrame const& frame) {
+        EXPECT_EQ(frame.sequence % 3 + 1, frame.num_bananas);
+        for (std::size_t i = 0; i < frame.num_bananas; ++i) {
+            EXPECT_EQ(static_cast<double>(frame.sequence), frame.bananas[i].length);
+        }
+    };
+
+    constexpr std::uint64_t kNumFrames = 10000;
+    std::atomic<bool> done{false};
+    std::vector<std::jthread> readers;
+    for (auto t = 0; t < 2; ++t) {
+        readers.emplace_back([&] {
+            std::uint64_t last_sequence = 0;
+            while (!done.load()) {
+                if (auto const frame = bus.ReadLatest()) {
+                    expect_consistent(*frame);
+                    EXPECT_GE(frame->sequence, last_sequence);
+                    last_sequence = frame->sequence;
+                }
+            }
+        });
+        // subscribed before the first frame is published, thus every frame must either be read or be missed
+        readers.emplace_back([&, subscriber = banana::ResultBus::Subscriber{bus}]() mutable {
+            std::uint64_t frames_read = 0;
+            std::optional<std::uint64_t> last_sequence;
+            while (!done.load() || last_sequence != kNumFrames - 1) {
+                if (auto const frame = subscriber.Poll()) {
+                    expect_consistent(*frame);
+                    EXPECT_TRUE(!last_sequence.has_value() || frame->sequence > *last_sequence);
+                    last_sequence = frame->sequence;
+                    ++frames_read;
+                }
+            }
+            EXPECT_EQ(kNumFrames, frames_read + subscriber.GetMissedFrames());
+        });
+    }
+    for (std::uint64_t i = 0; i < kNumFrames; ++i) {
+        EXPECT_EQ(i, bus.Publish(make_frame(i), start + std::chrono::milliseconds{static_cast<std::int64_t>(i)}));
+    }
+    done.store(true);
+    readers.clear();
+
+    auto const latest = bus.ReadLatest();
+    ASSERT_TRUE(latest.has_value());
+    ASSERT_EQ(kNumFrames - 1, latest->sequence);
+    ASSERT_EQ(std::chrono::nanoseconds{start.time_since_epoch() + std::chrono::milliseconds{kNumFrames - 1}}.count(), latest->captured_at_ns);
+    ASSERT_EQ(banana::ResultBus::ReadError::kOverwritten, bus.Read(0).error());
+    ASSERT_EQ(banana::ResultBus::ReadError::kNotYetPublished, bus.Read(kNumFrames).error());
+
+    // a subscriber which didn't read anything only gets the frames which are still on the bus
+    for (std::uint64_t i = kNumFrames - 8; i < kNumFrames; ++i) {
+        auto const frame = late_subscriber.Poll();
+        ASSERT_TRUE(frame.has_value());
+        ASSERT_EQ(i, frame->sequence);
+    }
+    ASSERT_FALSE(late_subscriber.Poll().has_value());
+    ASSERT_EQ(kNumFrames - 8, late_subscriber.GetMissedFrames());
+}
@@ -0,0 +1,150 @@
+#include <cstdint>
+#include <format>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tuple>
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "shared-ring.hpp"
+
+namespace {
+    /// Name of a shared memory object which no other test (or test run) uses at the same time.
+    auto GetUniqueName(std::string const& test) -> std::string {
+        return std::format("/banana-daemon-test-{}-{}", getpid(), test);
+    }
+}
+
+TEST(SharedRingTestSuite, HandOverFrames) {
+    auto const name = GetUniqueName("handover");
+    auto const daemon = bananad::SharedRing::Create(name, 4, 1024);
+    auto const producer = bananad::SharedRing::Open(name);
+    ASSERT_EQ(4, producer.GetHeader().num_slots);
+    ASSERT_EQ(1024, producer.GetHeader().frame_capacity);
+
+    auto const first = producer.TryAcquireSlot();
+    auto const second = producer.TryAcquireSlot();
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    ASSERT_NE(*first, *second);
+    ASSERT_EQ(getpid(), producer.GetSlot(*first).owner_pid.load());
+    ASSERT_EQ(2, daemon.CountSlots(bananad::SlotState::kWriting));
+
+    // nothing is handed over before it's published, then the oldest frame comes first
+    ASSERT_FALSE(daemon.TryClaimOldestReady().has_value());
+    producer.GetFrameData(*second)[0] = 42;
+    producer.Publish(*second, 16, 16, 48, BANANA_PIXEL_FORMAT_BGR8);
+    producer.Publish(*first, 8, 8, 24, BANANA_PIXEL_FORMAT_BGR8);
+    ASSERT_EQ(2, daemon.CountSlots(bananad::SlotState::kReady));
+
+    auto const claimed = daemon.TryClaimOldestReady();
+    ASSERT_EQ(second, claimed);
+    ASSERT_EQ(42, daemon.GetFrameData(*claimed)[0]);
+    ASSERT_EQ(16, daemon.GetSlot(*claimed).width);
+    ASSERT_FALSE(producer.IsDone(*claimed));
+    daemon.Complete(*claimed);
+    ASSERT_TRUE(producer.IsDone(*claimed));
+    producer.Release(*claimed);
+
+    ASSERT_EQ(first, daemon.TryClaimOldestReady());
+    ASSERT_FALSE(daemon.TryClaimOldestReady().has_value());
+    daemon.Complete(*first);
+    producer.Release(*first);
+    ASSERT_EQ(4, daemon.CountSlots(bananad::SlotState::kFree));
+    ASSERT_EQ(0, daemon.GetSlot(*first).owner_pid.load());
+}
+
+TEST(SharedRingTestSuite, AllSlotsInUse) {
+    auto const name = GetUniqueName("full");
+    auto const daemon = bananad::SharedRing::Create(name, 2, 64);
+    auto const producer = bananad::SharedRing::Open(name);
+
+    auto const first = producer.TryAcquireSlot();
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(producer.TryAcquireSlot().has_value());
+    ASSERT_FALSE(producer.TryAcquireSlot().has_value());
+
+    producer.Release(*first);
+    ASSERT_EQ(first, producer.TryAcquireSlot());
+}
+
+TEST(SharedRingTestSuite, RefuseSecondDaemon) {
+    auto const name = GetUniqueName("second");
+    {
+        auto const daemon = bananad::SharedRing::Create(name, 2, 64);
+        ASSERT_THROW(std::ignore = bananad::SharedRing::Create(name, 2, 64), std::runtime_error);
+        // the running daemon's ring is still there
+        ASSERT_NO_THROW(std::ignore = bananad::SharedRing::Open(name));
+    }
+    // the lock has been released with the ring of the first daemon
+    ASSERT_NO_THROW(std::ignore = bananad::SharedRing::Create(name, 2, 64));
+    ASSERT_THROW(std::ignore = bananad::SharedRing::Open(name), std::system_error);
+}
+
+TEST(SharedRingTestSuite, RefuseUninitialisedObject) {
+    // as seen by a producer between the creation and the resizing of the object by the daemon
+    auto const name = GetUniqueName("uninitialised");
+    auto const fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    ASSERT_GE(fd, 0);
+    ASSERT_THROW(std::ignore = bananad::SharedRing::Open(name), std::runtime_error);
+
+    // resized but not yet initialised
+    ASSERT_EQ(0, ftruncate(fd, static_cast<off_t>(bananad::GetSharedMemorySize(2, 64))));
+    ASSERT_THROW(std::ignore = bananad::SharedRing::Open(name), std::runtime_error);
+
+    close(fd);
+    shm_unlink(name.c_str());
+}
+
+TEST(SharedRingTestSuite, ReclaimSlotsOfDeadProducer) {
+    auto const name = GetUniqueName("reclaim");
+    auto const daemon = bananad::SharedRing::Create(name, 4, 64);
+
+    // a producer which dies while owning one slot it's writing, one it has published and one with results
+    auto const producer_pid = fork();
+    ASSERT_GE(producer_pid, 0);
+    if (producer_pid == 0) {
+        auto const producer = bananad::SharedRing::Open(name);
+        auto const writing = producer.TryAcquireSlot();
+        auto const published = producer.TryAcquireSlot();
+        auto const done = producer.TryAcquireSlot();
+        if (!writing || !published || !done) {
+            _exit(1);
+        }
+        producer.Publish(*published, 8, 8, 24, BANANA_PIXEL_FORMAT_BGR8);
+        producer.Publish(*done, 8, 8, 24, BANANA_PIXEL_FORMAT_BGR8);
+        _exit(0); // without releasing anything
+    }
+    int status;
+    ASSERT_EQ(producer_pid, waitpid(producer_pid, &status, 0));
+    ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    auto const analysed = daemon.TryClaimOldestReady();
+    ASSERT_TRUE(analysed.has_value());
+    daemon.Complete(*analysed);
+    auto const analysing = daemon.TryClaimOldestReady();
+    ASSERT_TRUE(analysing.has_value());
+
+    // the frame which is still being analysed keeps its slot until it's done
+    ASSERT_EQ(2, daemon.ReclaimAbandonedSlots());
+    ASSERT_EQ(3, daemon.CountSlots(bananad::SlotState::kFree));
+    ASSERT_EQ(1, daemon.CountSlots(bananad::SlotState::kProcessing));
+    ASSERT_EQ(producer_pid, daemon.GetSlot(*analysing).owner_pid.load());
+
+    daemon.Complete(*analysing);
+    ASSERT_EQ(1, daemon.ReclaimAbandonedSlots());
+    ASSERT_EQ(4, daemon.CountSlots(bananad::SlotState::kFree));
+    ASSERT_EQ(0, daemon.ReclaimAbandonedSlots());
+
+    // slots of running producers are left alone
+    auto const own = daemon.TryAcquireSlot();
+    ASSERT_TRUE(own.has_value());
+    ASSERT_EQ(0, daemon.ReclaimAbandonedSlots());
+    ASSERT_EQ(bananad::SlotState::kWriting, daemon.GetSlot(*own).state.load());
+}
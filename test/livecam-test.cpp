@@ -0,0 +1,433 @@
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <filesystem>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include <opencv2/opencv.hpp>
+
+#include "analysis-pool.hpp"
+#include "frame-selector.hpp"
+#include "latency-governor.hpp"
+#include "video-recorder.hpp"
+
+namespace {
+    /// Analyse function which blocks in the first call until it's released, thus the test can queue up frames.
+    class BlockingAnalysis {
+    public:
+        auto operator()(std::size_t const source, cv::Mat const& frame, livecam::Clock::time_point) -> livecam::FrameAnalysis {
+            if (!is_first_call_done_.exchange(true)) {
+                started_.release();
+                released_.acquire();
+            }
+            if (frame.empty()) {
+                throw std::runtime_error("empty frame");
+            }
+            std::scoped_lock const lock{mutex_};
+            analysed_.emplace_back(source, frame.at<int>(0));
+            return {.result = banana::AnnotatedAnalysisResult{}};
+        }
+
+        /// Wait until the first frame is being analysed, then submit the frames and release the analysis.
+        void WaitUntilStarted() {
+            started_.acquire();
+        }
+
+        void Release() {
+            released_.release();
+        }
+
+        /// Source and value of the frames analysed so far, in the order of the analysis.
+        [[nodiscard]]
+        auto GetAnalysed() -> std::vector<std::pair<std::size_t, int>> {
+            std::scoped_lock const lock{mutex_};
+            return analysed_;
+        }
+
+    private:
+        std::atomic<bool> is_first_call_done_{false};
+        std::binary_semaphore started_{0};
+        std::binary_semaphore released_{0};
+        std::mutex mutex_;
+        std::vector<std::pair<std::size_t, int>> analysed_;
+    };
+
+    /// A frame carrying a value by which the test can recognise it.
+    auto CreateFrame(int const value) -> cv::Mat {
+        return cv::Mat{1, 1, CV_32SC1, cv::Scalar(value)};
+    }
+
+    void WaitUntilIdle(livecam::AnalysisPool const& pool, std::size_t const num_sources) {
+        for (std::size_t source = 0; source < num_sources; ++source) {
+            while (!pool.IsIdle(source)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    /// A parsed JSON value, objects keep the order of their members.
+    struct JsonValue {
+        typedef std::vector<JsonValue> Array;
+        typedef std::vector<std::pair<std::string, JsonValue>> Object;
+
+        std::variant<std::nullptr_t, bool, double, std::string, Array, Object> value;
+
+        [[nodiscard]]
+        auto operator[](std::string_view const key) const -> JsonValue const& {
+            for (auto const& [name, member] : std::get<Object>(value)) {
+                if (name == key) {
+                    return member;
+                }
+            }
+            throw std::out_of_range(std::string{key});
+        }
+
+        [[nodiscard]]
+        auto operator[](std::size_t const index) const -> JsonValue const& {
+            return std::get<Array>(value).at(index);
+        }
+    };
+
+    /// Minimal JSON parser for checking the sidecar files (no escape sequences in strings), throws on invalid input.
+    class JsonParser {
+    public:
+        static auto Parse(std::string_view const text) -> JsonValue {
+            JsonParser parser{text};
+            auto value = parser.ParseValue();
+            if (parser.position_ != text.size()) {
+                throw std::invalid_argument("trailing characters");
+            }
+            return value;
+        }
+
+    private:
+        explicit JsonParser(std::string_view const text) : text_(text) {}
+
+        auto ParseValue() -> JsonValue {
+            if (this->Consume("null")) {
+                return {nullptr};
+            }
+            if (this->Consume("true")) {
+                return {true};
+            }
+            if (this->Consume("false")) {
+                return {false};
+            }
+            if (this->Consume("\"")) {
+                auto const end = text_.find('"', position_);
+                if (end == std::string_view::npos) {
+                    throw std::invalid_argument("unterminated string");
+                }
+                std::string string{text_.substr(position_, end - position_)};
+                position_ = end + 1;
+                return {std::move(string)};
+            }
+            if (this->Consume("[")) {
+                JsonValue::Array array;
+                while (array.empty() ? !this->Consume("]") : !this->Expect(",]")) {
+                    array.push_back(this->ParseValue());
+                }
+                return {std::move(array)};
+            }
+            if (this->Consume("{")) {
+                JsonValue::Object object;
+                while (object.empty() ? !this->Consume("}") : !this->Expect(",}")) {
+                    auto key = std::get<std::string>(this->ParseValue().value);
+                    this->Expect(":");
+                    object.emplace_back(std::move(key), this->ParseValue());
+                }
+                return {std::move(object)};
+            }
+
+            double number;
+            auto const [end, error] = std::from_chars(text_.data() + position_, text_.data() + text_.size(), number);
+            if (error != std::errc{}) {
+                throw std::invalid_argument("invalid value");
+            }
+            position_ = static_cast<std::size_t>(end - text_.data());
+            return {number};
+        }
+
+        /// Skip the token if it's next.
+        auto Consume(std::string_view const token) -> bool {
+            if (!text_.substr(position_).starts_with(token)) {
+                return false;
+            }
+            position_ += token.size();
+            return true;
+        }
+
+        /// Skip one of the characters, which must be next. Returns whether it was the last one (closing a list).
+        auto Expect(std::string_view const characters) -> bool {
+            auto const index = position_ < text_.size() ? characters.find(text_[position_]) : std::string_view::npos;
+            if (index == std::string_view::npos) {
+                throw std::invalid_argument(std::string{"expected one of "} + std::string{characters});
+            }
+            ++position_;
+            return index == characters.size() - 1 && characters.size() > 1;
+        }
+
+        std::string_view const text_;
+        std::size_t position_{0};
+    };
+
+    auto CreateRecordedResult(std::size_t const frame_number) -> livecam::SourceResult {
+        return {
+            .frame_number = frame_number,
+            .captured_at = livecam::Clock::now(),
+            .latency = {},
+            .analysis = {.result = banana::AnnotatedAnalysisResult{.annotated_image = CreateFrame(0), .banana = {}}},
+        };
+    }
+
+    void ReportLatency(livecam::LatencyGovernor& governor, std::size_t const frames, std::chrono::milliseconds const latency) {
+        for (std::size_t i = 0; i < frames; ++i) {
+            governor.Report(latency);
+        }
+    }
+}
+
+TEST(LatencyGovernorTestSuite, LowerAndRaiseQuality) {
+    using namespace std::chrono_literals;
+    livecam::LatencyGovernor governor{{.target_latency = 100ms, .raise_threshold = 0.6, .hold_frames = 10}};
+    ASSERT_EQ(livecam::QualityLevel::kFull, governor.GetLevel());
+
+    // too slow: the level is lowered step by step, but each level is held for 10 frames first
+    ReportLatency(governor, 9, 150ms);
+    ASSERT_EQ(livecam::QualityLevel::kFull, governor.GetLevel());
+    ReportLatency(governor, 1, 150ms);
+    ASSERT_EQ(livecam::QualityLevel::kNoVerboseAnnotations, governor.GetLevel());
+    ReportLatency(governor, 10, 150ms);
+    ASSERT_EQ(livecam::QualityLevel::kHalfResolution, governor.GetLevel());
+    ReportLatency(governor, 10, 150ms);
+    ASSERT_EQ(livecam::QualityLevel::kSkipFrames, governor.GetLevel());
+    ReportLatency(governor, 20, 150ms);
+    ASSERT_EQ(livecam::QualityLevel::kSkipFrames, governor.GetLevel());
+
+    // below the target but above the raise threshold: the level is kept
+    ReportLatency(governor, 20, 80ms);
+    ASSERT_EQ(livecam::QualityLevel::kSkipFrames, governor.GetLevel());
+
+    // fast again: the smoothed latency (~81 ms) needs two frames to drop below 60 ms
+    ReportLatency(governor, 1, 10ms);
+    ASSERT_EQ(livecam::QualityLevel::kSkipFrames, governor.GetLevel());
+    ReportLatency(governor, 1, 10ms);
+    ASSERT_EQ(livecam::QualityLevel::kHalfResolution, governor.GetLevel());
+    ReportLatency(governor, 9, 10ms);
+    ASSERT_EQ(livecam::QualityLevel::kHalfResolution, governor.GetLevel());
+    ReportLatency(governor, 1, 10ms);
+    ASSERT_EQ(livecam::QualityLevel::kNoVerboseAnnotations, governor.GetLevel());
+    ReportLatency(governor, 100, 10ms);
+    ASSERT_EQ(livecam::QualityLevel::kFull, governor.GetLevel());
+}
+
+TEST(LatencyGovernorTestSuite, SingleSpikeDoesNotLowerQuality) {
+    using namespace std::chrono_literals;
+    livecam::LatencyGovernor governor{{.target_latency = 100ms, .raise_threshold = 0.6, .hold_frames = 10}};
+
+    ReportLatency(governor, 20, 50ms);
+    ReportLatency(governor, 1, 200ms); // smoothed: 0.8 * 50 + 0.2 * 200 = 70 ms
+    ReportLatency(governor, 10, 50ms);
+    ASSERT_EQ(livecam::QualityLevel::kFull, governor.GetLevel());
+}
+
+TEST(FrameSelectorTestSuite, SceneChangeOnSkippedFrame) {
+    livecam::FrameSelector selector{banana::SceneChangeDetector::Settings{}};
+    cv::Mat const empty_scene{360, 640, CV_8UC3, cv::Scalar::all(0)};
+    cv::Mat const changed_scene{360, 640, CV_8UC3, cv::Scalar::all(200)};
+    constexpr auto kSkipFrames = livecam::QualityLevel::kSkipFrames;
+
+    ASSERT_TRUE(selector.NeedsAnalysis(empty_scene, kSkipFrames));
+    ASSERT_FALSE(selector.NeedsAnalysis(empty_scene, kSkipFrames)); // skipped
+    ASSERT_FALSE(selector.NeedsAnalysis(empty_scene, kSkipFrames)); // unchanged
+    // the scene changes on a skipped frame, the next frame must still be compared with the last analysed one
+    ASSERT_FALSE(selector.NeedsAnalysis(changed_scene, kSkipFrames));
+    ASSERT_TRUE(selector.NeedsAnalysis(changed_scene, kSkipFrames));
+    ASSERT_FALSE(selector.NeedsAnalysis(changed_scene, kSkipFrames)); // skipped
+    ASSERT_FALSE(selector.NeedsAnalysis(changed_scene, kSkipFrames)); // unchanged
+}
+
+TEST(FrameSelectorTestSuite, SkipEverySecondFrame) {
+    livecam::FrameSelector selector{std::nullopt};
+    cv::Mat const frame{360, 640, CV_8UC3, cv::Scalar::all(0)};
+
+    ASSERT_TRUE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kHalfResolution));
+    ASSERT_TRUE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kHalfResolution));
+    ASSERT_TRUE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kSkipFrames));
+    ASSERT_FALSE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kSkipFrames));
+    ASSERT_TRUE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kSkipFrames));
+
+    // leaving the level in the middle of a pair doesn't carry the pending skip over to the next time the level is used
+    ASSERT_TRUE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kHalfResolution));
+    ASSERT_TRUE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kSkipFrames));
+    ASSERT_FALSE(selector.NeedsAnalysis(frame, livecam::QualityLevel::kSkipFrames));
+}
+
+TEST(AnalysisPoolTestSuite, LatestFrameWins) {
+    BlockingAnalysis analysis;
+    std::vector<std::size_t> finished_frames;
+    livecam::AnalysisPool pool{std::ref(analysis), 1, 1, [&](std::size_t, livecam::SourceResult const& result) {
+        finished_frames.push_back(result.frame_number);
+    }};
+
+    pool.Submit(0, CreateFrame(0), livecam::Clock::now());
+    analysis.WaitUntilStarted();
+    // only the latest of the frames arriving while the worker is busy is analysed
+    for (auto value = 1; value <= 3; ++value) {
+        pool.Submit(0, CreateFrame(value), livecam::Clock::now());
+    }
+    analysis.Release();
+    WaitUntilIdle(pool, 1);
+
+    ASSERT_EQ((std::vector<std::pair<std::size_t, int>>{{0, 0}, {0, 3}}), analysis.GetAnalysed());
+    ASSERT_EQ((std::vector<std::size_t>{0, 3}), finished_frames);
+    auto const stats = pool.GetStats(0);
+    ASSERT_EQ(4, stats.captured_frames);
+    ASSERT_EQ(2, stats.analyzed_frames);
+    ASSERT_EQ(2, stats.dropped_frames);
+    ASSERT_EQ(3, pool.TakeResult(0)->frame_number);
+    ASSERT_FALSE(pool.TakeResult(0).has_value());
+}
+
+TEST(AnalysisPoolTestSuite, ServeSourcesRoundRobin) {
+    BlockingAnalysis analysis;
+    livecam::AnalysisPool pool{std::ref(analysis), 3, 1};
+
+    pool.Submit(0, CreateFrame(0), livecam::Clock::now());
+    analysis.WaitUntilStarted();
+    // source 0 submitted first, but the other sources are served before its next frame
+    pool.Submit(0, CreateFrame(1), livecam::Clock::now());
+    pool.Submit(2, CreateFrame(2), livecam::Clock::now());
+    pool.Submit(1, CreateFrame(3), livecam::Clock::now());
+    analysis.Release();
+    WaitUntilIdle(pool, 3);
+
+    ASSERT_EQ((std::vector<std::pair<std::size_t, int>>{{0, 0}, {1, 3}, {2, 2}, {0, 1}}), analysis.GetAnalysed());
+}
+
+TEST(AnalysisPoolTestSuite, ExceptionFailsOnlyTheFrame) {
+    BlockingAnalysis analysis;
+    livecam::AnalysisPool pool{std::ref(analysis), 2, 2, [](std::size_t const source, livecam::SourceResult const& result) {
+        if (source == 1 && result.frame_number == 0) {
+            throw std::runtime_error("recorder failed");
+        }
+    }};
+
+    pool.Submit(0, CreateFrame(0), livecam::Clock::now());
+    analysis.WaitUntilStarted();
+    analysis.Release();
+    pool.Submit(0, cv::Mat{}, livecam::Clock::now()); // the analysis throws
+    pool.Submit(1, CreateFrame(1), livecam::Clock::now());
+    WaitUntilIdle(pool, 2);
+
+    auto const failed_analysis = pool.TakeResult(0);
+    ASSERT_TRUE(failed_analysis.has_value());
+    ASSERT_FALSE(failed_analysis->analysis.result.has_value());
+    ASSERT_EQ(1, pool.GetStats(0).failed_frames);
+    auto const failed_handling = pool.TakeResult(1);
+    ASSERT_TRUE(failed_handling.has_value());
+    ASSERT_FALSE(failed_handling->analysis.result.has_value());
+    ASSERT_EQ(1, pool.GetStats(1).failed_frames);
+
+    // the workers are still running
+    pool.Submit(0, CreateFrame(2), livecam::Clock::now());
+    WaitUntilIdle(pool, 2);
+    ASSERT_TRUE(pool.TakeResult(0)->analysis.result.has_value());
+    ASSERT_EQ(3, pool.GetStats(0).analyzed_frames);
+    ASSERT_EQ(1, pool.GetStats(0).failed_frames);
+}
+
+TEST(VideoRecorderTestSuite, DropFramesWhileStalled) {
+    std::binary_semaphore write_started{0};
+    std::binary_semaphore write_released{0};
+    std::vector<std::size_t> written_frames;
+    {
+        livecam::VideoRecorder recorder{[&](livecam::RecordedFrame const& frame) {
+            if (written_frames.empty()) {
+                write_started.release();
+                write_released.acquire();
+            }
+            written_frames.push_back(frame.frame_number);
+        }, 2};
+
+        ASSERT_TRUE(recorder.Submit(CreateRecordedResult(0)));
+        write_started.acquire();
+        // the encoder is stuck in the first frame, only two more frames fit into the queue
+        for (std::size_t frame_number = 1; frame_number <= 5; ++frame_number) {
+            ASSERT_EQ(frame_number <= 2, recorder.Submit(CreateRecordedResult(frame_number)));
+        }
+        auto const stats = recorder.GetStats();
+        ASSERT_EQ(0, stats.recorded_frames);
+        ASSERT_EQ(3, stats.dropped_frames);
+        ASSERT_EQ(2, stats.queued_frames);
+
+        // failed analyses are never recorded
+        auto failed = CreateRecordedResult(6);
+        failed.analysis.result = std::unexpected{"failed"};
+        ASSERT_FALSE(recorder.Submit(failed));
+        ASSERT_EQ(3, recorder.GetStats().dropped_frames);
+
+        write_released.release();
+    }
+    // the queue is written before the recorder is gone
+    ASSERT_EQ((std::vector<std::size_t>{0, 1, 2}), written_frames);
+}
+
+TEST(VideoRecorderTestSuite, ParseSidecarLine) {
+    livecam::RecordedFrame const frame{
+        .frame_number = 42,
+        .captured_at_s = 1.5,
+        .latency_ms = 12.25,
+        .is_reused = true,
+        .quality_level = livecam::QualityLevel::kSkipFrames,
+        .annotated_image = {},
+        .bananas = {
+            {.estimated_center = {10, 20}, .rotation_angle = 0.5, .mean_curvature = 0.01, .length = 150, .ripeness = 0.75f, .ripeness_uncertainty = 0.125f},
+            {.estimated_center = {-3, 7}, .rotation_angle = -1, .mean_curvature = std::numeric_limits<double>::quiet_NaN(), .length = 80, .ripeness = 1, .ripeness_uncertainty = 0},
+        },
+    };
+
+    auto const line = livecam::FormatSidecarLine(frame);
+    ASSERT_EQ(std::string::npos, line.find('\n'));
+    auto const json = JsonParser::Parse(line);
+
+    ASSERT_EQ(42, std::get<double>(json["frame"].value));
+    ASSERT_DOUBLE_EQ(1.5, std::get<double>(json["captured_at_s"].value));
+    ASSERT_DOUBLE_EQ(12.25, std::get<double>(json["latency_ms"].value));
+    ASSERT_TRUE(std::get<bool>(json["reused"].value));
+    ASSERT_EQ(static_cast<int>(livecam::QualityLevel::kSkipFrames), std::get<double>(json["quality_level"].value));
+
+    auto const& bananas = std::get<JsonValue::Array>(json["bananas"].value);
+    ASSERT_EQ(2, bananas.size());
+    ASSERT_EQ(10, std::get<double>(bananas[0]["center"][0].value));
+    ASSERT_EQ(20, std::get<double>(bananas[0]["center"][1].value));
+    ASSERT_DOUBLE_EQ(0.5, std::get<double>(bananas[0]["rotation_angle"].value));
+    ASSERT_DOUBLE_EQ(0.01, std::get<double>(bananas[0]["mean_curvature"].value));
+    ASSERT_DOUBLE_EQ(150, std::get<double>(bananas[0]["length"].value));
+    ASSERT_DOUBLE_EQ(0.75, std::get<double>(bananas[0]["ripeness"].value));
+    ASSERT_DOUBLE_EQ(0.125, std::get<double>(bananas[0]["ripeness_uncertainty"].value));
+    ASSERT_EQ(-3, std::get<double>(bananas[1]["center"][0].value));
+    // not representable in JSON
+    ASSERT_TRUE(std::holds_alternative<std::nullptr_t>(bananas[1]["mean_curvature"].value));
+}
+
+TEST(VideoRecorderTestSuite, RejectUnknownVideoFormat) {
+    auto const directory = std::filesystem::temp_directory_path();
+    ASSERT_THROW(livecam::VideoRecorder(directory / "recording.gif", directory / "recording.jsonl", 25, 1), std::invalid_argument);
+    // rejected before anything has been created
+    ASSERT_FALSE(std::filesystem::exists(directory / "recording.jsonl"));
+}
@@ -1,5 +1,6 @@
 #include <gtest/gtest.h>
 
+#include <polyfit/Polynomial2DAccumulator.hpp>
 #include <polyfit/Polynomial2DFit.hpp>
 
 #include "polyfit-test-util.hpp"
@@ -40,3 +41,96 @@ TEST(Polynomial2DFitTestSuite, FitSimpleCurve2) {
     ASSERT_TRUE(result);
     ASSERT_COEFFS_NEAR(-1, 3, 2, *result);
 }
+
+/** y = -1 + 3*x + 2*x^2 */
+TEST(Polynomial2DAccumulatorTestSuite, SameResultAsFit) {
+    std::vector<std::pair<double, double>> points = {
+            {-1,-2},
+            {0,-1},
+            {1,4},
+            {2,13},
+    };
+    polyfit::Polynomial2DAccumulator const accumulator{points};
+    auto const result = accumulator.GetCoefficients();
+    ASSERT_TRUE(result);
+    ASSERT_COEFFS_NEAR(-1, 3, 2, *result);
+}
+
+/** y = 1 + x, fitted far away from the origin */
+TEST(Polynomial2DAccumulatorTestSuite, FitWithOrigin) {
+    polyfit::Polynomial2DAccumulator accumulator{1000};
+    for (auto x = 990; x <= 1010; ++x) {
+        accumulator.Add(x, 1 + x);
+    }
+    auto const result = accumulator.GetCoefficients();
+    ASSERT_TRUE(result);
+    ASSERT_COEFFS_NEAR(1, 1, 0, *result);
+}
+
+/** y = 3 - 0.5*x + 0.002*x^2 with x in pixel coordinates, i.e. the sums of x^4 are much larger than the sum of the weights */
+TEST(Polynomial2DAccumulatorTestSuite, FitImageScaleWithoutOrigin) {
+    polyfit::Polynomial2DAccumulator accumulator;
+    for (auto x = 1200; x <= 1800; ++x) {
+        accumulator.Add(x, 3 - 0.5 * x + 0.002 * x * x);
+    }
+    auto const result = accumulator.GetCoefficients();
+    ASSERT_TRUE(result);
+    // far away from the origin the fit is worse conditioned, thus a0 (= the extrapolation to x = 0) is less precise
+    auto const& [coeff_0, coeff_1, coeff_2] = *result;
+    ASSERT_NEAR(3, coeff_0, 1e-4);
+    ASSERT_NEAR(-0.5, coeff_1, 1e-6);
+    ASSERT_NEAR(0.002, coeff_2, 1e-9);
+
+    // a line through two distinct x coordinates still doesn't determine a parabola
+    polyfit::Polynomial2DAccumulator two_columns;
+    for (auto y = 0; y < 10; ++y) {
+        two_columns.Add(1500, y);
+        two_columns.Add(1501, y, 0.5);
+    }
+    ASSERT_FALSE(two_columns.GetCoefficients());
+}
+
+TEST(Polynomial2DAccumulatorTestSuite, AddAndRemovePoints) {
+    polyfit::Polynomial2DAccumulator accumulator;
+    ASSERT_FALSE(accumulator.GetCoefficients());
+
+    // y = -1 + x^2 plus an outlier which is removed again
+    accumulator.Add(-1, 0);
+    accumulator.Add(0, -1);
+    ASSERT_FALSE(accumulator.GetCoefficients()); // two points don't determine a parabola
+    accumulator.Add(1, 0);
+    accumulator.Add(5, 100);
+    accumulator.Remove(5, 100);
+    auto const result = accumulator.GetCoefficients();
+    ASSERT_TRUE(result);
+    ASSERT_COEFFS_NEAR(-1, 0, 1, *result);
+    ASSERT_DOUBLE_EQ(3, accumulator.GetTotalWeight());
+
+    accumulator.Remove(-1, 0);
+    accumulator.Remove(0, -1);
+    accumulator.Remove(1, 0);
+    ASSERT_FALSE(accumulator.GetCoefficients());
+}
+
+TEST(Polynomial2DAccumulatorTestSuite, WeightedPoints) {
+    std::vector<std::pair<double, double>> points = {
+            {-1,0},
+            {0,-1},
+            {0,-1},
+            {1,0},
+            {2,3},
+    };
+    polyfit::Polynomial2DAccumulator accumulator;
+    accumulator.Add(-1, 0);
+    accumulator.Add(0, -1, 2); // same as adding it twice
+    accumulator.Add(1, 0);
+    accumulator.Add(2, 3);
+    accumulator.Add(3, 42, 0.5);
+    accumulator.Remove(3, 42, 0.5);
+
+    auto const expected = polyfit::Fit2DPolynomial(points);
+    auto const result = accumulator.GetCoefficients();
+    ASSERT_TRUE(expected);
+    ASSERT_TRUE(result);
+    ASSERT_COEFFS_NEAR(std::get<0>(*expected), std::get<1>(*expected), std::get<2>(*expected), *result);
+}